@@ -172,7 +172,7 @@ int main()
 // optimize() plugs into the definition of operator*, etc.
         auto f_small_op = [](auto && A, auto && B)
             {
-                return sum(A*B); // TODO really slow with rank>2 or even rank>1 depending on the sizes
+                return sum(A*B);
             };
 
 #define DEFINE_SMALL_PLY(name, plier)                                   \
@@ -90,6 +90,11 @@ int main()
                   {
                       c += transpose<1, 0>(a);
                   });
+            bench("frametransp-tiled", m, n, reps,
+                  [](auto & c, auto const & a)
+                  {
+                      for_each(ra::tiled, [](auto & c, auto a) { c += a; }, c, transpose<1, 0>(a));
+                  });
         };
 
     bench_all(1, 1000000, 20);
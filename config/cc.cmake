@@ -9,8 +9,13 @@ set (BASE_CXXFLAGS "-std=c++20 -Wall -Werror -fdiagnostics-color=always -Wno-unk
 -Werror=zero-as-null-pointer-constant")
 set (CMAKE_CXX_FLAGS "${BASE_CXXFLAGS} $ENV{CXXFLAGS}")
 
+# for ra::par.
+set (THREADS_PREFER_PTHREAD_FLAG ON)
+find_package (Threads REQUIRED)
+
 foreach (target ${TARGETS})
   add_executable (${target} "${target}.cc")
+  target_link_libraries (${target} Threads::Threads)
   add_test (${target} ${target})
 endforeach ()
 
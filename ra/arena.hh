@@ -0,0 +1,126 @@
+// -*- mode: c++; coding: utf-8 -*-
+/// @file arena.hh
+/// @brief Scoped arena for the storage of temporary arrays.
+
+// This library is free software; you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option) any
+// later version.
+
+#pragma once
+#include <new>
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <algorithm>
+#include <type_traits>
+
+namespace ra {
+
+// Monotonic buffer. Memory is only given back on reset(), which makes all of it available again without freeing
+// the blocks. While an ArenaScope is alive, the storage of ArenaBig made on the same thread comes from its arena.
+// That includes the results of concrete(), gemm() etc. with ArenaBig as template argument (see concrete.hh). Arrays
+// made in an arena must not be used after the arena is reset.
+struct Arena
+{
+    struct Block
+    {
+        std::byte * p;
+        std::size_t size;
+    };
+
+    std::vector<Block> blocks;
+    std::size_t block_size;
+    std::size_t current = 0, used = 0; // in blocks[current]
+    std::size_t count_ = 0, bytes_ = 0, peak_ = 0;
+
+    constexpr static std::align_val_t block_align { 64 };
+
+    explicit Arena(std::size_t block_size_ = 1<<20): block_size(block_size_) {}
+    Arena(Arena const &) = delete;
+    Arena & operator=(Arena const &) = delete;
+    ~Arena()
+    {
+        for (auto & b: blocks) {
+            ::operator delete(b.p, block_align);
+        }
+    }
+
+    void * allocate(std::size_t n, std::size_t align)
+    {
+        for (;; ++current, used = 0) {
+            if (current==blocks.size()) {
+                std::size_t size = std::max(block_size, n+align);
+                blocks.push_back(Block { static_cast<std::byte *>(::operator new(size, block_align)), size });
+            }
+            std::size_t start = (used+align-1)/align*align;
+            if (start+n<=blocks[current].size) {
+                used = start+n;
+                ++count_;
+                bytes_ += n;
+                peak_ = std::max(peak_, bytes_);
+                return blocks[current].p+start;
+            }
+        }
+    }
+    void reset()
+    {
+        current = 0;
+        used = 0;
+        count_ = 0;
+        bytes_ = 0;
+    }
+
+// Number of allocations and bytes allocated since the last reset(), and most bytes ever allocated between resets.
+    std::size_t count() const { return count_; }
+    std::size_t bytes() const { return bytes_; }
+    std::size_t peak() const { return peak_; }
+    std::size_t capacity() const { std::size_t c = 0; for (auto & b: blocks) { c += b.size; } return c; }
+
+    static inline thread_local Arena * current_arena = nullptr;
+};
+
+// Make arena the current arena of this thread until the end of the scope.
+struct ArenaScope
+{
+    Arena * previous;
+    explicit ArenaScope(Arena & arena): previous(Arena::current_arena) { Arena::current_arena = &arena; }
+    ArenaScope(ArenaScope const &) = delete;
+    ArenaScope & operator=(ArenaScope const &) = delete;
+    ~ArenaScope() { Arena::current_arena = previous; }
+};
+
+// Allocator that takes memory from the arena that was current when it was made, or from the heap if there was none.
+// Containers don't move storage across allocators, so assigning an arena array to a heap array copies the elements,
+// and so does swapping them (see swap(Container, Container) in big.hh).
+template <class T>
+struct arena_allocator
+{
+    using value_type = T;
+    using propagate_on_container_move_assignment = std::false_type;
+    using propagate_on_container_swap = std::false_type;
+    using is_always_equal = std::false_type;
+
+    Arena * arena = Arena::current_arena;
+
+    arena_allocator() noexcept = default;
+    template <class U> arena_allocator(arena_allocator<U> const & a) noexcept: arena(a.arena) {}
+
+    T * allocate(std::size_t n)
+    {
+        return arena ? static_cast<T *>(arena->allocate(n*sizeof(T), alignof(T))) : std::allocator<T>().allocate(n);
+    }
+    void deallocate(T * p, std::size_t n) noexcept
+    {
+        if (!arena) {
+            std::allocator<T>().deallocate(p, n);
+        }
+    }
+// copies go wherever the current arena is.
+    arena_allocator select_on_container_copy_construction() const { return arena_allocator(); }
+
+    template <class U> bool operator==(arena_allocator<U> const & b) const { return arena==b.arena; }
+    template <class U> bool operator!=(arena_allocator<U> const & b) const { return arena!=b.arena; }
+};
+
+} // namespace ra
@@ -19,12 +19,13 @@ template <class V> inline constexpr decltype(auto) shape(V const & v);
 template <class C> struct Scalar;
 
 // Separate from Scalar so that operator+=, etc. has the array meaning there.
+// It refers to Scalar::c instead of being a cast of Scalar, so that writes through it are seen by Scalar.
 template <class C>
-struct ScalarFlat: public Scalar<C>
+struct ScalarFlat
 {
+    C & c;
     constexpr void operator+=(dim_t d) const {}
-    constexpr C & operator*() { return this->c; }
-    constexpr C const & operator*() const { return this->c; } // [ra39]
+    constexpr C & operator*() const { return c; }
 };
 
 // Wrap constant for traversal. We still want f(C) to be a specialization in most cases.
@@ -43,8 +44,8 @@ struct Scalar
     constexpr static void adv(rank_t k, dim_t d) {}
     constexpr static dim_t stride(int k) { return 0; }
     constexpr static bool keep_stride(dim_t st, int z, int j) { return true; }
-    constexpr decltype(auto) flat() { return static_cast<ScalarFlat<C> &>(*this); }
-    constexpr decltype(auto) flat() const { return static_cast<ScalarFlat<C> const &>(*this); } // [ra39]
+    constexpr auto flat() { return ScalarFlat<C> { c }; }
+    constexpr auto flat() const { return ScalarFlat<C const> { c }; } // [ra39]
 
     FOR_EACH(RA_DEF_ASSIGNOPS, =, *=, +=, -=, /=)
 };
@@ -94,6 +95,7 @@ struct Vector
         RA_CHECK(d==1 || d<=0, " k ", k, " d ", d, " (Vector)");
         p__ += (k==0) * d;
     }
+    constexpr void jump(rank_t k, dim_t d) { p__ += (k==0) * d; }
     constexpr static dim_t stride(int k) { return k==0 ? 1 : 0; }
     constexpr static bool keep_stride(dim_t st, int z, int j) { return (z==0) == (j==0); }
     constexpr auto flat() const { return p__; }
@@ -126,6 +128,7 @@ struct Ptr
         RA_CHECK(d==1 || d<=0, " k ", k, " d ", d, " (Ptr)");
         std::advance(p__, (k==0) * d);
     }
+    constexpr void jump(rank_t k, dim_t d) { std::advance(p__, (k==0) * d); }
     constexpr static dim_t stride(int k) { return k==0 ? 1 : 0; }
     constexpr static bool keep_stride(dim_t st, int z, int j) { return (z==0) == (j==0); }
     constexpr auto flat() const { return p__; }
@@ -158,6 +161,7 @@ struct Span
         RA_CHECK(d==1 || d<=0, " k ", k, " d ", d, " (Span)");
         std::advance(p__, (k==0) * d);
     }
+    constexpr void jump(rank_t k, dim_t d) { std::advance(p__, (k==0) * d); }
     constexpr static dim_t stride(int k) { return k==0 ? 1 : 0; }
     constexpr static bool keep_stride(dim_t st, int z, int j) { return (z==0) == (j==0); }
     constexpr auto flat() const { return p__; }
@@ -189,6 +193,7 @@ struct TensorIndex
 
     template <class I> constexpr value_type at(I const & ii) const { return value_type(ii[w]); }
     constexpr void adv(rank_t k, dim_t d) { RA_CHECK(d<=1, " d ", d); i += (k==w) * d; }
+    constexpr void jump(rank_t k, dim_t d) { i += (k==w) * d; }
     constexpr static dim_t const stride(int k) { return (k==w); }
     constexpr static bool keep_stride(dim_t st, int z, int j) { return st*stride(z)==stride(j); }
     constexpr decltype(auto) flat() const { return TensorIndexFlat<w, value_type> {i}; }
@@ -10,7 +10,10 @@
 
 #pragma once
 #include "ra/small.hh"
+#include "ra/arena.hh"
+#include "ra/track.hh"
 #include <memory>
+#include <new>
 #include <iostream>
 
 namespace ra {
@@ -22,6 +25,104 @@ struct Dim { dim_t size, stride; };
 inline std::ostream & operator<<(std::ostream & o, Dim const & dim)
 { o << "[Dim " << dim.size << " " << dim.stride << "]"; return o; }
 
+// Vector of trivially copyable T that holds up to N elements in place and only goes to the heap beyond that. Used
+// for the dope vector of var rank View, so that subscripting and iteration don't allocate for typical ranks.
+template <class T, int N>
+struct InlineVector
+{
+    static_assert(std::is_trivially_copyable_v<T>);
+
+    dim_t n = 0;
+    std::unique_ptr<T []> heap;
+    T buf[N];
+
+    constexpr InlineVector() {}
+    explicit InlineVector(dim_t n_) { resize(n_); }
+    InlineVector(dim_t n_, T const & t) { resize(n_); std::fill(begin(), end(), t); }
+    template <class I> requires (!std::is_integral_v<I>)
+    InlineVector(I b, I e) { resize(std::distance(b, e)); std::copy(b, e, begin()); }
+    InlineVector(std::initializer_list<T> x): InlineVector(x.begin(), x.end()) {}
+    InlineVector(InlineVector const & x): InlineVector(x.begin(), x.end()) {}
+    InlineVector(InlineVector && x): n(x.n), heap(std::move(x.heap))
+    {
+        if (!heap) {
+            std::copy(x.buf, x.buf+n, buf);
+        }
+        x.n = 0;
+    }
+// from other sequences, e.g. the dope vector of fixed rank View.
+    template <class V> requires (requires (V const & v) { std::begin(v); std::end(v); }
+                                 && !std::is_same_v<std::decay_t<V>, InlineVector>)
+    InlineVector(V const & v): InlineVector(std::begin(v), std::end(v)) {}
+    InlineVector & operator=(InlineVector const & x)
+    {
+        if (this!=&x) {
+            resize(x.n);
+            std::copy(x.begin(), x.end(), begin());
+        }
+        return *this;
+    }
+    InlineVector & operator=(InlineVector && x)
+    {
+        if (this!=&x) {
+            if (x.heap) {
+                heap = std::move(x.heap);
+                n = x.n;
+            } else {
+                resize(x.n);
+                std::copy(x.buf, x.buf+x.n, begin());
+            }
+            x.n = 0;
+        }
+        return *this;
+    }
+
+    constexpr dim_t size() const { return n; }
+    constexpr bool empty() const { return 0==n; }
+    constexpr T * data() { return heap ? heap.get() : buf; }
+    constexpr T const * data() const { return heap ? heap.get() : buf; }
+    constexpr T * begin() { return data(); }
+    constexpr T const * begin() const { return data(); }
+    constexpr T * end() { return data()+n; }
+    constexpr T const * end() const { return data()+n; }
+    constexpr T & operator[](dim_t i) { return data()[i]; }
+    constexpr T const & operator[](dim_t i) const { return data()[i]; }
+    constexpr T & back() { return data()[n-1]; }
+    constexpr T const & back() const { return data()[n-1]; }
+
+// new elements are value initialized, as in std::vector.
+    void resize(dim_t m)
+    {
+        dim_t cap = heap ? std::max(dim_t(N), n) : N; // heap is only replaced when growing
+        if (m>cap) {
+            std::unique_ptr<T []> h(new T[m]);
+            std::copy(begin(), end(), h.get());
+            heap = std::move(h);
+        }
+        std::fill(data()+std::min(n, m), data()+m, T {});
+        n = m;
+    }
+};
+
+template <class T, int N> constexpr bool is_foreign_vector_def<InlineVector<T, N>> = true;
+
+template <class T, int N>
+struct ra_traits_def<InlineVector<T, N>>
+{
+    using V = InlineVector<T, N>;
+    using value_type = T;
+    constexpr static auto shape(V const & v) { return std::array<dim_t, 1> { v.size() }; }
+    static V make(dim_t const n) { return V(n); }
+    template <class TT> static V make(dim_t n, TT const & t) { return V(n, t); }
+    constexpr static dim_t size(V const & v) { return v.size(); }
+    constexpr static dim_t size_s() { return DIM_ANY; }
+    constexpr static rank_t rank(V const & v) { return 1; }
+    constexpr static rank_t rank_s() { return 1; }
+};
+
+// Rank of var rank View beyond which the dope vector is allocated.
+constexpr int dimv_inline = 8;
+
 
 // --------------------
 // nested braces for Container initializers
@@ -179,19 +280,29 @@ struct cell_iterator
 
 // Always C order. If you need another, transpose this.
 // Works on dim vector with sizes already assigned, so that I can work from an expr. Not pretty though.
-template <class D>
-dim_t filldim(int n, D dend)
+// lead(n) gives the stride of the dimension next to the innermost, so rows can be padded. See aligned_allocator.
+template <class D, class Lead>
+dim_t filldim(int n, D dend, Lead && lead)
 {
     dim_t next = 1;
-    for (; n>0; --n) {
+    for (int k=0; n>0; --n, ++k) {
         --dend;
         RA_CHECK((*dend).size>=0, "bad dim", (*dend).size);
         (*dend).stride = next;
         next *= (*dend).size;
+        if (k==0 && n>1) {
+            next = lead(next);
+        }
     }
     return next;
 }
 
+template <class D>
+dim_t filldim(int n, D dend)
+{
+    return filldim(n, dend, [](dim_t n) { return n; });
+}
+
 template <class D>
 dim_t proddim(D d, D dend)
 {
@@ -372,7 +483,7 @@ struct View
         constexpr rank_t subrank = rank_diff(RANK, ra::size_s<I>());  /* gcc accepts i.size() */ \
         using Sub = View<T CONST, subrank>;                             \
         if constexpr (subrank==RANK_ANY) {                              \
-            return Sub { typename Sub::Dimv(dim.begin()+ra::size(i), dim.end()),  /* Dimv is std::vector */ \
+            return Sub { typename Sub::Dimv(dim.begin()+ra::size(i), dim.end()),  /* Dimv is InlineVector */ \
                     data() + Indexer1::index_p(dim, i) };               \
         } else {                                                        \
             return Sub { typename Sub::Dimv(ptr(dim.begin()+ra::size(i))),  /* Dimv is ra::Small */ \
@@ -429,7 +540,7 @@ struct ra_traits_def<View<T, RANK>>
 template <class T>
 struct View<T, RANK_ANY>
 {
-    using Dimv = std::vector<Dim>; // maybe use Unique<Dim, 1> here.
+    using Dimv = InlineVector<Dim, dimv_inline>;
 
     Dimv dim;
     T * p;
@@ -470,7 +581,7 @@ struct View<T, RANK_ANY>
     template <class I>                                                  \
     auto at(I && i) CONST                                               \
     {                                                                   \
-        return View<T CONST, RANK_ANY> { Dimv(dim.begin()+i.size(), dim.end()), /* Dimv is std::vector */ \
+        return View<T CONST, RANK_ANY> { Dimv(dim.begin()+i.size(), dim.end()), /* Dimv is InlineVector */ \
                 data() + Indexer1::index_p(dim, i) };                   \
     }                                                                   \
     constexpr decltype(auto) operator[](dim_t const i) CONST            \
@@ -524,20 +635,45 @@ struct ra_traits_def<View<T, RANK_ANY>>
 // Container types
 // --------------------
 
+// lead(n) is the padded length of rows of n elements. If padded is false, Container is always compact.
+// If emplace is true, elements can be constructed in place in row-major order with V::emplace_back().
 template <class V> struct storage_traits
 {
-    using T = std::decay_t<decltype(*std::declval<V>().get())>;
-    static V create(dim_t n) { RA_CHECK(n>=0); return V(new T[n]); }
+    using T = std::remove_reference_t<decltype(*std::declval<V>().get())>; // keep const for read-only stores.
+    constexpr static bool padded = false;
+    static V create(dim_t n)
+    {
+        RA_CHECK(n>=0);
+        T * p = new T[n];
+        if constexpr (RA_DO_TRACK && !free_by_owner) {
+            V v(p, track_delete<T>());
+            track_alloc(p, n*sizeof(T));
+            return v;
+        } else {
+            track_alloc(p, n*sizeof(T));
+            return V(p, std::default_delete<T []>()); // std::shared_ptr<T> would use delete otherwise.
+        }
+    }
+// the deleter of std::unique_ptr is fixed, so Container reports its blocks freed instead. See Container::track_free().
+    constexpr static bool free_by_owner = !std::is_constructible_v<V, T *, track_delete<T>>;
     static T const * data(V const & v) { return v.get(); }
     static T * data(V & v) { return v.get(); }
+    constexpr static dim_t lead(dim_t n) { return n; }
+    constexpr static bool touch = false;
+    constexpr static bool emplace = false;
 };
 template <class T_, class A> struct storage_traits<std::vector<T_, A>>
 {
     using T = T_;
     static_assert(!std::is_same_v<std::remove_const_t<T>, bool>, "No pointers to bool in std::vector<bool>");
+    constexpr static bool padded = [] { if constexpr (requires { A::padded; }) { return A::padded; } else { return false; } }();
     static std::vector<T, A> create(dim_t n) { return std::vector<T, A>(n); }
     static T const * data(std::vector<T, A> const & v) { return v.data(); }
     static T * data(std::vector<T, A> & v) { return v.data(); }
+    constexpr static dim_t lead(dim_t n) { if constexpr (padded) { return A::lead(n); } else { return n; } }
+    constexpr static bool touch = [] { if constexpr (requires { A::first_touch; }) { return A::first_touch; } else { return false; } }();
+    constexpr static bool emplace = !padded;
+    constexpr static bool free_by_owner = false;
 };
 
 template <class T, rank_t RANK> inline
@@ -556,6 +692,33 @@ bool is_c_order(View<T, RANK> const & a)
     return true;
 }
 
+// Write to every page of a, with the chunks on axis 0 that ply_par uses for c-order a, pinned to the same threads
+// (see ThreadPool::run), so that each page is placed on the NUMA node of the thread that will traverse it in a later
+// ply_par with the same policy from the same thread. For stores that aren't placed until first written to, such as
+// huge_allocator (see huge.hh). The contents of a are not changed.
+constexpr dim_t first_touch_page = 4096;
+
+template <class T, rank_t RANK>
+inline void
+first_touch(View<T, RANK> const & a, par_t const & policy=par)
+{
+    if (a.rank()==0 || a.size()==0) {
+        return;
+    }
+    dim_t const n = a.size(0);
+    int const m = int(std::min(dim_t(policy.threads()), n));
+    char * const p = (char *)(a.data());
+    dim_t const row = a.stride(0)*sizeof(T);
+    policy.pool().run(m, [&](int t)
+                          {
+                              char * const e = p + par_split(n, m, t+1)*row;
+                              for (char * c = p + par_split(n, m, t)*row; c<e; c+=first_touch_page) {
+                                  volatile char * v = c;
+                                  *v = *v;
+                              }
+                          }, true);
+}
+
 // TODO be convertible to View only, so that View::p is not duplicated
 template <class Store, rank_t RANK>
 struct Container: public View<typename storage_traits<Store>::T, RANK>
@@ -570,6 +733,15 @@ struct Container: public View<typename storage_traits<Store>::T, RANK>
     View & view() { return *this; }
     View const & view() const { return *this; }
 
+// for stores whose blocks can't be followed through the store itself, see storage_traits::free_by_owner.
+    void track_free()
+    {
+        if constexpr (RA_DO_TRACK && storage_traits<Store>::free_by_owner) {
+            ra::track_free(storage_traits<Store>::data(store));
+        }
+    }
+    ~Container() { track_free(); }
+
     template <class ... A> decltype(auto) operator()(A && ... a) { return View::operator()(std::forward<A>(a) ...); }
     template <class ... A> decltype(auto) operator()(A && ... a) const { return View::operator()(std::forward<A>(a) ...); }
 
@@ -595,6 +767,9 @@ struct Container: public View<typename storage_traits<Store>::T, RANK>
 // TODO don't require copiable T from constructors, see fill1 below. That requires initialization and not update semantics for operator=.
     Container & operator=(Container && w)
     {
+        if (this!=&w) {
+            track_free();
+        }
         store = std::move(w.store);
         View::dim = std::move(w.dim);
         View::p = storage_traits<Store>::data(store);
@@ -621,7 +796,8 @@ struct Container: public View<typename storage_traits<Store>::T, RANK>
         for (Dim & dimi: View::dim) { dimi = {0, 1}; } // 1 so we can push_back()
     }
 
-    template <class S> void init(S && s)
+// Set the dims from shape s, and return the size of the store.
+    template <class S> dim_t init_dim(S && s)
     {
         static_assert(!std::is_convertible_v<value_t<S>, Dim>);
 // no rank extension here, because it's error prone and not very useful.
@@ -631,13 +807,95 @@ struct Container: public View<typename storage_traits<Store>::T, RANK>
             ra::resize(View::dim, ra::size(s));
         }
         for_each([](Dim & dim, auto const & s) { dim.size = s; }, View::dim, s);
-        dim_t t = filldim(View::dim.size(), View::dim.end());
-        store = storage_traits<Store>::create(t);
+        return filldim(View::dim.size(), View::dim.end(), storage_traits<Store>::lead);
+    }
+
+    template <class S> void init(S && s)
+    {
+        track_free();
+        store = storage_traits<Store>::create(init_dim(s));
         View::p = storage_traits<Store>::data(store);
+        if constexpr (storage_traits<Store>::touch) {
+            first_touch(view());
+        }
+    }
+
+// Elements that aren't trivial are constructed directly from the source if the store allows it, instead of being
+// default constructed and then assigned. Then T needs only be constructible from the source, e.g. move constructible
+// from a prvalue. Other stores (e.g. Unique) still default construct and assign.
+    constexpr static bool emplace = storage_traits<Store>::emplace && !std::is_trivial_v<T>;
+
+// Set the dims from shape s, and make room for them in the store, which is left empty. See emplace.
+    template <class S> void init_reserve(S && s)
+    {
+        store.reserve(init_dim(s));
+        View::p = store.data();
+        if constexpr (storage_traits<Store>::touch) {
+            first_touch(view());
+        }
+    }
+
+// Whether the elements can be constructed from x in place, i.e. whether x is traversed once for each element. x
+// mustn't have more axes than the array, and its sizes must agree with those of the array on the axes it has.
+    template <class X> bool emplace_match(X && x) const
+    {
+        auto && xi = ra::start(x);
+        rank_t const r = ra::rank(xi);
+        if (r>this->rank()) {
+            return false;
+        }
+        for (rank_t k=0; k<r; ++k) {
+            if (dim_t n=xi.size(k); n!=DIM_BAD && n!=this->size(k)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+// Init from shape s and the elements of x, with the usual frame matching. In place, x is traversed in row-major order.
+// Otherwise, the elements are default constructed and x is assigned to them.
+    template <class S, class X> void init(S && s, X && x)
+    {
+        if constexpr (emplace) {
+            init_reserve(s);
+            if (emplace_match(x)) {
+                for_each(ra::ordered, [this](T &, auto && xi) { store.emplace_back(std::forward<decltype(xi)>(xi)); },
+                         view(), x);
+                assert(dim_t(store.size())==this->size());
+                View::p = store.data();
+            } else if constexpr (std::is_default_constructible_v<T> && std::is_copy_assignable_v<T>) {
+                store.resize(this->size());
+                View::p = store.data();
+                view() = x;
+            } else {
+                RA_CHECK(false, "cannot construct elements from a source of different shape");
+                abort();
+            }
+        } else {
+            init(s);
+            view() = x;
+        }
+    }
+
+// Init from shape s and the row-major ravel [xbegin, xbegin+xsize). With DIM_ANY, xsize is taken from s.
+    template <class S, class Pbegin> void init1(S && s, dim_t xsize, Pbegin xbegin)
+    {
+        if constexpr (emplace) {
+            init_reserve(s);
+            xsize = (xsize==DIM_ANY) ? this->size() : xsize;
+            RA_CHECK(this->size()==xsize, "mismatched sizes");
+            for (dim_t i=0; i<xsize; ++i, ++xbegin) {
+                store.emplace_back(*xbegin);
+            }
+            View::p = store.data();
+        } else {
+            init(s);
+            fill1((xsize==DIM_ANY) ? this->size() : xsize, xbegin);
+        }
     }
 
 // FIXME use of fill1 requires T to be copiable, this is unfortunate as it conflicts with the semantics of view_.operator=.
-// store(x) avoids it for Big, but doesn't work for Unique. Should construct in place as std::vector does.
+// init1() avoids it for vector stores, but not for Unique.
     template <class Pbegin> void fill1(dim_t xsize, Pbegin xbegin)
     {
         RA_CHECK(this->size()==xsize, "mismatched sizes");
@@ -648,10 +906,10 @@ struct Container: public View<typename storage_traits<Store>::T, RANK>
 
 // explicit shape.
     Container(shape_arg const & s, none_t) { init(s); }
-    template <class XX> Container(shape_arg const & s, XX && x): Container(s, none) { view() = x; }
+    template <class XX> Container(shape_arg const & s, XX && x) { init(s, x); }
 
 // shape from data.
-    template <class XX> Container(XX && x): Container(ra::shape(x), none) { view() = x; }
+    template <class XX> Container(XX && x) { init(ra::shape(x), x); }
     Container(typename nested_braces<T, RANK>::list x)
     {
         static_assert(RANK!=RANK_ANY);
@@ -662,42 +920,146 @@ struct Container: public View<typename storage_traits<Store>::T, RANK>
     }
 
 // braces row-major ravel for rank!=1
-    Container(typename View::ravel_arg x)
-        : Container({dim_t(x.size())}, none) { fill1(x.size(), x.begin()); }
+    Container(typename View::ravel_arg x) { init1(std::array<dim_t, 1> { dim_t(x.size()) }, x.size(), x.begin()); }
 
 // shape + row-major ravel. // TODO Maybe remove these? See also small.hh.
-    Container(shape_arg const & s, std::initializer_list<T> x)
-        : Container(s, none) { fill1(x.size(), x.begin()); }
+    Container(shape_arg const & s, std::initializer_list<T> x) { init1(s, x.size(), x.begin()); }
     template <class TT>
-    Container(shape_arg const & s, TT * p)
-        : Container(s, none) { fill1(this->size(), p); }
+    Container(shape_arg const & s, TT * p) { init1(s, DIM_ANY, p); }
     template <class P>
-    Container(shape_arg const & s, P pbegin, P pend)
-        : Container(s, none) { fill1(this->size(), pbegin); }
+    Container(shape_arg const & s, P pbegin, P pend) { init1(s, DIM_ANY, pbegin); }
 
 // these are needed when shape_arg is std::vector, since that doesn't handle conversions like Small does.
     template <class SS> Container(SS && s, none_t) { init(s); }
-    template <class SS, class XX> Container(SS && s, XX && x): Container(s, none) { view() = x; }
-    template <class SS> Container(SS const & s, std::initializer_list<T> x)
-        : Container(s, none) { fill1(x.size(), x.begin()); }
+    template <class SS, class XX> Container(SS && s, XX && x) { init(s, x); }
+    template <class SS> Container(SS const & s, std::initializer_list<T> x) { init1(s, x.size(), x.begin()); }
 
     using View::operator=;
 
-// only for some kinds of store.
+// only for some kinds of store. The strides are kept, so these work after resize_axis() too.
     void resize(dim_t const s)
     {
         static_assert(RANK==RANK_ANY || RANK>0); RA_CHECK(this->rank()>0);
-        store.resize(proddim(View::dim.begin()+1, View::dim.end())*s);
+        RA_CHECK(s>=0, "bad size ", s);
         View::dim[0].size = s;
+        store.resize(s*View::dim[0].stride);
         View::p = store.data();
     }
     void resize(dim_t const s, T const & t)
     {
         static_assert(RANK==RANK_ANY || RANK>0); RA_CHECK(this->rank()>0);
-        store.resize(proddim(View::dim.begin()+1, View::dim.end())*s, t);
+        RA_CHECK(s>=0, "bad size ", s);
         View::dim[0].size = s;
+        store.resize(s*View::dim[0].stride, t);
+        View::p = store.data();
+    }
+// room for s along axis 0 without reallocation.
+    void reserve(dim_t const s)
+    {
+        static_assert(RANK==RANK_ANY || RANK>0); RA_CHECK(this->rank()>0);
+        store.reserve(s*View::dim[0].stride);
         View::p = store.data();
     }
+// Resize axis k to s. Unless k is 0, the room for axis k is the stride of axis k-1, as with the padded rows of
+// Padded, so the array may not be compact afterwards. The subarrays are moved (in bulk) only when s doesn't fit in
+// that room, and then the room at least doubles, so resizing an axis step by step takes amortized constant moves and
+// allocations per step. Shrinking keeps the room. With t, new elements are set to t; otherwise their value is
+// unspecified.
+    void resize_axis(int const k, dim_t const s)
+    {
+        resize_axis_(k, s);
+    }
+    void resize_axis(int const k, dim_t const s, T const & t)
+    {
+        dim_t const a = resize_axis_(k, s);
+        if (s>a) {
+            View v = view();
+            v.dim[k].size = s-a;
+            v.p += a*v.stride(k);
+            v = t;
+        }
+    }
+// Append x along axis k, with the usual frame matching against the shape of the array without axis k.
+    template <class X>
+    void append(int const k, X && x)
+    {
+        dim_t const n = this->size(k);
+        resize_axis(k, n+1);
+        ra::View<T, RANK==RANK_ANY ? RANK_ANY : RANK-1> slab;
+        if constexpr (RANK==RANK_ANY) {
+            slab.dim.resize(this->rank()-1);
+        }
+        for (int j=0, i=0; j<this->rank(); ++j) {
+            if (j!=k) {
+                slab.dim[i++] = View::dim[j];
+            }
+        }
+        slab.p = this->data() + n*this->stride(k);
+        slab = x;
+    }
+// Return the old size of axis k. The strides never shrink, so every element moves forward in the store, if at all.
+    dim_t resize_axis_(int const k, dim_t const s)
+    {
+        static_assert(RANK==RANK_ANY || RANK>0); RA_CHECK(inside(k, this->rank()), "bad axis ", k);
+        RA_CHECK(s>=0, "bad size ", s);
+        dim_t const a = View::dim[k].size;
+        if (k==0) {
+            dim_t const n = s*View::dim[0].stride;
+            if (n>dim_t(store.capacity())) {
+                store.reserve(std::max(n, 2*dim_t(store.capacity())));
+            }
+            store.resize(n);
+            View::dim[0].size = s;
+            View::p = store.data();
+            return a;
+        }
+        View::dim[k].size = s;
+        if (s*View::dim[k].stride<=View::dim[k-1].stride) {
+            return a;
+        }
+        auto const dim0 = View::dim;
+        dim_t const room = std::max(s, 2*a)*View::dim[k].stride;
+        View::dim[k-1].stride = (k==this->rank()-1) ? storage_traits<Store>::lead(room) : room;
+        for (int j=k-2; j>=0; --j) {
+            View::dim[j].stride = std::max(View::dim[j].stride, View::dim[j+1].size*View::dim[j+1].stride);
+        }
+        dim_t const n = View::dim[0].size*View::dim[0].stride;
+        if (n>dim_t(store.size())) {
+            store.resize(n);
+        }
+// move the subarrays before axis k, last first.
+        auto offset = [k](auto const & dim, dim_t o)
+        {
+            dim_t c = 0;
+            for (int j=k-1; j>=0; --j) {
+                c += (o % dim[j].size)*dim[j].stride;
+                o /= dim[j].size;
+            }
+            return c;
+        };
+        dim_t const keep = std::min(a, s)*View::dim[k].stride;
+        for (dim_t o=proddim(View::dim.begin(), View::dim.begin()+k)-1; o>0; --o) {
+            T * const b = store.data()+offset(dim0, o);
+            std::move_backward(b, b+keep, store.data()+offset(View::dim, o)+keep);
+        }
+        View::p = store.data();
+        return a;
+    }
+// Move the elements to row-major order, if resize_axis() left room between them. Elements only move backward in the
+// store, so they can be moved one by one in row-major order.
+    void compact_()
+    {
+        if (!is_c_order(*this)) {
+            if constexpr (requires { store.erase(store.begin(), store.end()); }) {
+                T * q = store.data();
+                for_each(ra::ordered, [&q](T & x) { if (&x!=q) { *q = std::move(x); } ++q; }, view());
+                store.erase(store.begin()+filldim(View::dim.size(), View::dim.end()), store.end());
+                View::p = store.data();
+            } else {
+                RA_CHECK(false, "array isn't compact");
+            }
+        }
+    }
 // lets us move. A template + std::forward wouldn't work for push_back(brace-enclosed-list).
     void push_back(T && t)
     {
@@ -735,21 +1097,34 @@ struct Container: public View<typename storage_traits<Store>::T, RANK>
     T const & back() const { RA_CHECK(this->rank()==1 && this->size()>0); return store[this->size()-1]; }
     T & back() { RA_CHECK(this->rank()==1 && this->size()>0); return store[this->size()-1]; }
 
-// Container is always compact/row-major. Then the 0-rank STL-like iterators can be raw pointers. TODO But .iter() should also be able to benefit from this constraint, and the check should be faster for some cases (like RANK==1) or ellidable.
+// Unless padded, Container is compact/row-major, except after resize_axis(). Then the 0-rank STL-like iterators can be raw pointers. On a non-const Container, begin() and end() make it compact first; on a const one, it must already be. TODO But .iter() should also be able to benefit from this constraint, and the check should be faster for some cases (like RANK==1) or ellidable.
 
-    auto begin() { assert(is_c_order(*this)); return this->data(); }
-    auto begin() const { assert(is_c_order(*this)); return this->data(); }
-    auto end() { return this->data()+this->size(); }
-    auto end() const { return this->data()+this->size(); }
+    auto begin() { if constexpr (storage_traits<Store>::padded) { return View::begin(); } else { compact_(); return this->data(); } }
+    auto begin() const { if constexpr (storage_traits<Store>::padded) { return View::begin(); } else { RA_CHECK(is_c_order(*this), "array isn't compact after resize_axis()"); return this->data(); } }
+    auto end() { if constexpr (storage_traits<Store>::padded) { return View::end(); } else { compact_(); return this->data()+this->size(); } }
+    auto end() const { if constexpr (storage_traits<Store>::padded) { return View::end(); } else { return this->data()+this->size(); } }
 };
 
 template <class Store, rank_t RANK>
 struct ra_traits_def<Container<Store, RANK>>
     : public ra_traits_def<View<typename Container<Store, RANK>::T, RANK>> {};
 
+// Storage cannot be swapped between allocators that compare unequal and don't propagate on swap (arena_allocator
+// from different arenas). Then the elements are moved instead, and each container keeps its allocator.
 template <class Store, rank_t RANK>
 void swap(Container<Store, RANK> & a, Container<Store, RANK> & b)
 {
+    if constexpr (requires { a.store.get_allocator(); }) {
+        using traits = std::allocator_traits<decltype(a.store.get_allocator())>;
+        if constexpr (!traits::propagate_on_container_swap::value && !traits::is_always_equal::value) {
+            if (a.store.get_allocator()!=b.store.get_allocator()) {
+                Container<Store, RANK> c(std::move(a));
+                a = std::move(b);
+                b = std::move(c);
+                return;
+            }
+        }
+    }
     std::swap(a.dim, b.dim);
     std::swap(a.store, b.store);
     std::swap(a.p, b.p);
@@ -762,6 +1137,12 @@ struct default_init_allocator: public A
 {
     using a_t = std::allocator_traits<A>;
     using A::A;
+    default_init_allocator() = default;
+    default_init_allocator(A const & a): A(a) {}
+    default_init_allocator select_on_container_copy_construction() const
+    {
+        return default_init_allocator(a_t::select_on_container_copy_construction(*this));
+    }
 
     template <typename U>
     struct rebind
@@ -769,6 +1150,18 @@ struct default_init_allocator: public A
         using other = default_init_allocator<U, typename a_t::template rebind_alloc<U>>;
     };
 
+    auto allocate(std::size_t n)
+    {
+        auto p = a_t::allocate(static_cast<A &>(*this), n);
+        track_alloc(p, n*sizeof(typename a_t::value_type));
+        return p;
+    }
+    void deallocate(typename a_t::pointer p, std::size_t n)
+    {
+        track_free(p);
+        a_t::deallocate(static_cast<A &>(*this), p, n);
+    }
+
     template <typename U>
     void construct(U * ptr) noexcept(std::is_nothrow_default_constructible<U>::value)
     {
@@ -781,10 +1174,333 @@ struct default_init_allocator: public A
     }
 };
 
+// Allocator for storage aligned to align bytes. Like default_init_allocator, it does default initialization.
+// With pad, rows (along the innermost dimension) are padded to a multiple of align bytes, and by one more align if
+// that's a multiple of pad_critical bytes, so that the starts of consecutive rows don't fall on the same cache set.
+constexpr std::size_t pad_critical = 4096;
+
+template <class T, std::size_t align=64, bool pad=false>
+struct aligned_allocator
+{
+    static_assert(align>0 && 0==(align & (align-1)), "alignment must be a power of 2");
+    using value_type = T;
+    constexpr static bool padded = pad;
+
+    template <class U> struct rebind { using other = aligned_allocator<U, align, pad>; };
+
+    aligned_allocator() = default;
+    template <class U> constexpr aligned_allocator(aligned_allocator<U, align, pad> const &) noexcept {}
+
+    constexpr static std::align_val_t alignment { std::max(align, alignof(T)) };
+    T * allocate(std::size_t n)
+    {
+        T * p = static_cast<T *>(::operator new(n*sizeof(T), alignment));
+        track_alloc(p, n*sizeof(T));
+        return p;
+    }
+    void deallocate(T * p, std::size_t n) noexcept { track_free(p); ::operator delete(p, alignment); }
+
+    template <class U>
+    void construct(U * ptr) noexcept(std::is_nothrow_default_constructible<U>::value)
+    {
+        ::new(static_cast<void *>(ptr)) U;
+    }
+    template <class U, class ... A>
+    void construct(U * ptr, A && ... a)
+    {
+        ::new(static_cast<void *>(ptr)) U(std::forward<A>(a) ...);
+    }
+
+    constexpr static dim_t lead(dim_t n)
+    {
+        if constexpr (0!=align % sizeof(T)) {
+            return n;
+        } else {
+            constexpr dim_t k = align/sizeof(T);
+            dim_t m = (n+k-1)/k*k;
+            return (m>0 && 0==(m*sizeof(T)) % pad_critical) ? m+k : m;
+        }
+    }
+
+    template <class U> constexpr bool operator==(aligned_allocator<U, align, pad> const &) const { return true; }
+    template <class U> constexpr bool operator!=(aligned_allocator<U, align, pad> const &) const { return false; }
+};
+
 // Beyond this, we probably should have fixed-size (~std::dynarray), resizeable (~std::vector).
 template <class T, rank_t RANK=RANK_ANY> using Big = Container<std::vector<T, default_init_allocator<T>>, RANK>;
 template <class T, rank_t RANK=RANK_ANY> using Unique = Container<std::unique_ptr<T []>, RANK>;
 template <class T, rank_t RANK=RANK_ANY> using Shared = Container<std::shared_ptr<T>, RANK>;
+// Like Big, but aligned to align bytes. With Padded, rows are padded as in aligned_allocator, so the array isn't
+// compact, but it's still a valid View.
+template <class T, rank_t RANK=RANK_ANY, std::size_t align=64>
+using Aligned = Container<std::vector<T, aligned_allocator<T, align>>, RANK>;
+template <class T, rank_t RANK=RANK_ANY, std::size_t align=64>
+using Padded = Container<std::vector<T, aligned_allocator<T, align, true>>, RANK>;
+// Like Big, but takes its storage from the Arena that is current when it's made, if there is one (see arena.hh). It
+// keeps that storage when moved, so it must not outlive the arena.
+template <class T, rank_t RANK=RANK_ANY> using ArenaBig = Container<std::vector<T, default_init_allocator<T, arena_allocator<T>>>, RANK>;
+
+
+// --------------------
+// Copy-on-write arrays
+// --------------------
+
+// Copies of a Cow share their storage, like Shared, but any non-const access detaches, i.e. copies the storage
+// first if some other Cow holds it. Cow isn't a View, so writes can't bypass this. In expressions, Cow is read-only.
+// Views and iterators obtained from a Cow are invalidated by the next non-const access, as with the resize of a Big.
+// TODO Only Big storage for now.
+template <class T, rank_t RANK=RANK_ANY>
+struct Cow
+{
+    using Data = Big<T, RANK>;
+    using View = ra::View<T, RANK>;
+    using shape_arg = typename Data::shape_arg;
+
+    std::shared_ptr<Data> a;
+
+    constexpr static rank_t rank_s() { return RANK; }
+    constexpr static dim_t size_s() { return RANK==0 ? 1 : DIM_ANY; }
+    rank_t rank() const { return a->rank(); }
+    dim_t size() const { return a->size(); }
+    dim_t size(int const j) const { return a->size(j); }
+    dim_t stride(int const j) const { return a->stride(j); }
+    long use_count() const { return a.use_count(); }
+
+    void detach()
+    {
+        if (a.use_count()>1) {
+            a = std::make_shared<Data>(*a);
+        }
+    }
+
+    Cow(): a(std::make_shared<Data>()) {}
+    Cow(Data && x): a(std::make_shared<Data>(std::move(x))) {}
+    Cow(Data const & x): a(std::make_shared<Data>(x)) {}
+    Cow(shape_arg const & s, none_t): a(std::make_shared<Data>(s, none)) {}
+    template <class XX> Cow(shape_arg const & s, XX && x): a(std::make_shared<Data>(s, std::forward<XX>(x))) {}
+    Cow(shape_arg const & s, std::initializer_list<T> x): a(std::make_shared<Data>(s, x)) {}
+    Cow(typename nested_braces<T, RANK>::list x): a(std::make_shared<Data>(x)) {}
+
+// copies share. Assignment from anything else writes, so it detaches.
+    Cow(Cow const & x) = default;
+    Cow(Cow && x) = default;
+    Cow & operator=(Cow const & x) = default;
+    Cow & operator=(Cow & x) { a = x.a; return *this; }
+    Cow & operator=(Cow && x) = default;
+#define DEF_ASSIGNOPS(OP)                                               \
+    template <class X> Cow & operator OP (X && x) { detach(); a->view() OP x; return *this; }
+    FOR_EACH(DEF_ASSIGNOPS, =, *=, +=, -=, /=)
+#undef DEF_ASSIGNOPS
+
+    View const & view() const { return a->view(); }
+    View & view() { detach(); return a->view(); }
+    T const * data() const { return a->data(); }
+    T * data() { detach(); return a->data(); }
+
+    template <class ... I> decltype(auto) operator()(I && ... i) const { return view()(std::forward<I>(i) ...); }
+    template <class ... I> decltype(auto) operator()(I && ... i) { return view()(std::forward<I>(i) ...); }
+    decltype(auto) operator[](dim_t const i) const { return view()[i]; }
+    decltype(auto) operator[](dim_t const i) { return view()[i]; }
+    template <class I> decltype(auto) at(I && i) const { return view().at(std::forward<I>(i)); }
+    template <class I> decltype(auto) at(I && i) { return view().at(std::forward<I>(i)); }
+
+// reading a Cow in an expression shouldn't detach it, so iter() is always const. To write, use view().
+    template <rank_t c=0> auto iter() const & { return view().template iter<c>(); }
+// an iterator on a temporary Cow would outlive its storage.
+    template <rank_t c=0> auto iter() && = delete;
+    auto begin() const { return a->begin(); }
+    auto end() const { return a->end(); }
+    auto begin() { detach(); return a->begin(); }
+    auto end() { detach(); return a->end(); }
+};
+
+template <class T, rank_t RANK>
+struct ra_traits_def<Cow<T, RANK>>
+{
+    using V = Cow<T, RANK>;
+    using value_type = T;
+
+    static decltype(auto) shape(V const & v) { return ra::shape(v.view()); }
+    static dim_t size(V const & v) { return v.size(); }
+    static rank_t rank(V const & v) { return v.rank(); }
+    constexpr static rank_t rank_s() { return RANK; };
+    constexpr static dim_t size_s() { return RANK==0 ? 1 : DIM_ANY; }
+};
+
+
+// --------------------
+// Structure of arrays
+// --------------------
+
+// Element of SoA: N components of T at stride s. Like Small<T, N>, it has static size N, and can be subscripted, used
+// in expressions, assigned to, and converted to Small<T, N>. It refers to the SoA, so it's invalidated with it.
+template <class T, int N>
+struct SoAElement
+{
+    T * p;
+    dim_t s;
+
+    constexpr static rank_t rank_s() { return 1; }
+    constexpr static rank_t rank() { return 1; }
+    constexpr static dim_t size_s() { return N; }
+    constexpr static dim_t size() { return N; }
+    constexpr static dim_t size(int k) { return N; }
+    constexpr dim_t stride(int k) const { return s; }
+    constexpr T * data() const { return p; }
+
+    T & operator[](int c) const { RA_CHECK(inside(c, N), "bad component ", c); return p[c*s]; }
+    T & operator()(int c) const { return (*this)[c]; }
+    View<T, 1> view() const { return View<T, 1>({Dim {N, s}}, p); }
+    template <rank_t c=0> auto iter() const { return view().template iter<c>(); }
+    operator Small<std::remove_const_t<T>, N>() const
+    {
+        Small<std::remove_const_t<T>, N> x;
+        for (int c=0; c<N; ++c) {
+            x[c] = p[c*s];
+        }
+        return x;
+    }
+
+// assignment writes to the components, as with Small.
+    SoAElement const & operator=(SoAElement const & x) const { view() = x.view(); return *this; }
+#define DEF_ASSIGNOPS(OP)                                               \
+    template <class X> SoAElement const & operator OP (X && x) const { view() OP x; return *this; }
+    FOR_EACH(DEF_ASSIGNOPS, =, *=, +=, -=, /=)
+#undef DEF_ASSIGNOPS
+};
+
+template <class T, int N>
+struct ra_traits_def<SoAElement<T, N>>
+{
+    using V = SoAElement<T, N>;
+    using value_type = T;
+
+    constexpr static auto shape(V const & v) { return std::array<dim_t, 1> { N }; }
+    constexpr static dim_t size(V const & v) { return N; }
+    constexpr static rank_t rank(V const & v) { return 1; }
+    constexpr static rank_t rank_s() { return 1; };
+    constexpr static dim_t size_s() { return N; }
+};
+
+// Array of rank RANK of Small<T, N> elements, stored as N compact arrays of T, one for each component. As a View, it
+// has rank RANK+1, and the last axis is the component axis, with stride size()/N. So a(i ...) is the element at
+// (i ...), a SoAElement, and component(c) or a(ra::dots<RANK>, c) is the compact array of component c. With var
+// rank, the number of subscripts isn't known at compile time, so use element(i ...) for the element.
+// Assigning an array of elements (e.g. a Big<Small<T, N>, RANK>) to a SoA goes element by element.
+template <class T, int N, rank_t RANK=RANK_ANY>
+struct SoA: public View<T, rank_sum(RANK, 1)>
+{
+    using View = ra::View<T, rank_sum(RANK, 1)>;
+    using Store = std::vector<T, default_init_allocator<T>>;
+    using shape_arg = typename Big<Small<T, N>, RANK>::shape_arg;
+    Store store;
+
+    View & view() { return *this; }
+    View const & view() const { return *this; }
+
+    SoA(SoA && w): store(std::move(w.store)) { View::dim = std::move(w.dim); View::p = store.data(); }
+    SoA(SoA const & w): store(w.store) { View::dim = w.dim; View::p = store.data(); }
+    SoA(SoA & w): store(w.store) { View::dim = w.dim; View::p = store.data(); }
+    SoA & operator=(SoA && w) { store = std::move(w.store); View::dim = std::move(w.dim); View::p = store.data(); return *this; }
+    SoA & operator=(SoA const & w) { store = w.store; View::dim = w.dim; View::p = store.data(); return *this; }
+    SoA & operator=(SoA & w) { store = w.store; View::dim = w.dim; View::p = store.data(); return *this; }
+
+// empty. With var rank, the elements have rank 1.
+    SoA()
+    {
+        if constexpr (RANK==RANK_ANY) {
+            init(std::array<dim_t, 1> {0});
+        } else {
+            init(shape_arg(0));
+        }
+    }
+    SoA(shape_arg const & s, none_t) { init(s); }
+    template <class XX> SoA(shape_arg const & s, XX && x): SoA(s, none) { *this = x; }
+// shape from an array of elements.
+    template <class XX> SoA(XX && x): SoA(ra::shape(x), none) { *this = x; }
+
+// s is the shape of the array of elements, so it doesn't include the component axis.
+    template <class S> void init(S && s)
+    {
+        static_assert(1==ra::rank_s<S>(), "rank mismatch for init shape");
+        if constexpr (RANK==RANK_ANY) {
+            ra::resize(View::dim, ra::size(s)+1);
+        }
+        rank_t const r = View::dim.size()-1;
+        for_each([](Dim & dim, auto const & s) { dim.size = s; }, ptr(View::dim.data(), r), s);
+        dim_t const n = filldim(r, View::dim.begin()+r);
+        View::dim[r] = Dim { N, n };
+        store = Store(n*N);
+        View::p = store.data();
+    }
+
+// elements of x that are arrays themselves go to the components; otherwise x is matched against the View.
+    template <class X> SoA & operator=(X && x)
+    {
+        if constexpr (1==ra::rank_s<value_t<X>>()) {
+            ra::iter<1>(view()) = x;
+        } else {
+            view() = x;
+        }
+        return *this;
+    }
+
+    template <class ... I> SoAElement<T, N> element(I const & ... i)
+    {
+        rank_t const r = View::dim.size()-1;
+        RA_CHECK(r==rank_t(sizeof...(I)), "bad number of subscripts ", sizeof...(I), " for rank ", r);
+        dim_t const ii[] = { dim_t(i) ..., 0 };
+        dim_t k = 0;
+        for (rank_t j=0; j<r; ++j) {
+            RA_CHECK(inside(ii[j], View::dim[j].size), "bad subscript ", ii[j], " on axis ", j);
+            k += ii[j]*View::dim[j].stride;
+        }
+        return { View::p + k, View::dim[r].stride };
+    }
+    template <class ... I> SoAElement<T const, N> element(I const & ... i) const
+    {
+        auto e = const_cast<SoA &>(*this).element(i ...);
+        return { e.p, e.s };
+    }
+    template <class ... I> decltype(auto) operator()(I && ... i)
+    {
+        if constexpr (RANK!=RANK_ANY && sizeof...(I)==RANK && (std::is_integral_v<std::decay_t<I>> && ...)) {
+            return element(i ...);
+        } else {
+            return View::operator()(std::forward<I>(i) ...);
+        }
+    }
+    template <class ... I> decltype(auto) operator()(I && ... i) const
+    {
+        if constexpr (RANK!=RANK_ANY && sizeof...(I)==RANK && (std::is_integral_v<std::decay_t<I>> && ...)) {
+            return element(i ...);
+        } else {
+            return View::operator()(std::forward<I>(i) ...);
+        }
+    }
+    decltype(auto) operator[](dim_t const i) { return (*this)(i); }
+    decltype(auto) operator[](dim_t const i) const { return (*this)(i); }
+
+    auto component(int c)
+    {
+        RA_CHECK(inside(c, N), "bad component ", c);
+        rank_t const r = View::dim.size()-1;
+        ra::View<T, RANK> b;
+        ra::resize(b.dim, r);
+        std::copy(View::dim.begin(), View::dim.begin()+r, b.dim.begin());
+        b.p = View::p + c*View::dim[r].stride;
+        return b;
+    }
+    auto component(int c) const
+    {
+        auto b = const_cast<SoA &>(*this).component(c);
+        return ra::View<T const, RANK>(b.dim, b.p);
+    }
+};
+
+template <class T, int N, rank_t RANK>
+struct ra_traits_def<SoA<T, N, RANK>>
+    : public ra_traits_def<View<T, rank_sum(RANK, 1)>> {};
 
 // -------------
 // Used in the Guile wrappers to allow an array parameter to either borrow from Guile
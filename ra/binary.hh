@@ -0,0 +1,309 @@
+// -*- mode: c++; coding: utf-8 -*-
+/// @file binary.hh
+/// @brief Write and read arrays in a raw binary format.
+
+// This library is free software; you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option) any
+// later version.
+
+// The format is a header followed by the elements, each as in memory on the machine that wrote them:
+// [magic (8)] [byte order (4)] [version (4)] [type kind (4)] [sizeof(T) (4)] [rank (8)] [size (8) ...] [stride (8) ...]
+// [data ...]
+// All header fields are in the byte order of the writer. The strides are in elements and describe the data that
+// follows. write_binary always writes it in row-major order.
+
+#pragma once
+#include "ra/big.hh"
+#include <bit>
+#include <array>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <complex>
+#include <iostream>
+#include <algorithm>
+
+namespace ra {
+
+constexpr char binary_magic[8] = {'r', 'a', ':', ':', 'd', 'a', 't', 'a'};
+constexpr std::uint32_t binary_version = 1;
+constexpr std::uint32_t binary_order = 0x01020304;
+
+// Number of elements that are gathered at once to write a non-contiguous array, or scattered to read one.
+constexpr dim_t binary_chunk = 1<<16;
+
+// Type kinds are i (signed), u (unsigned), b (bool), f (floating point), c (complex), or V (anything else, which
+// isn't byte swapped).
+template <class T> constexpr char binary_kind = 'V';
+template <class T> requires (std::is_integral_v<T> && std::is_signed_v<T>) constexpr char binary_kind<T> = 'i';
+template <class T> requires (std::is_integral_v<T> && std::is_unsigned_v<T>) constexpr char binary_kind<T> = 'u';
+template <> constexpr char binary_kind<bool> = 'b';
+template <class T> requires (std::is_floating_point_v<T>) constexpr char binary_kind<T> = 'f';
+template <class T> constexpr char binary_kind<std::complex<T>> = 'c';
+
+struct BinaryHeader
+{
+    char kind;
+    std::uint32_t elsize;
+    bool swap = false; // the file was written with the opposite byte order.
+    std::vector<dim_t> shape, stride;
+
+    rank_t rank() const { return shape.size(); }
+    dim_t size() const { dim_t s = 1; for (dim_t k: shape) { s *= k; } return s; }
+    std::size_t bytes() const { return 8+4+4+4+4+8+16*shape.size(); }
+};
+
+template <class T>
+inline BinaryHeader
+binary_header(std::vector<dim_t> shape)
+{
+    std::vector<dim_t> stride(shape.size());
+    for (dim_t s=1, k=shape.size()-1; k>=0; --k) {
+        stride[k] = s;
+        s *= shape[k];
+    }
+    return BinaryHeader { binary_kind<T>, std::uint32_t(sizeof(T)), false, std::move(shape), std::move(stride) };
+}
+
+template <class T>
+constexpr T
+binary_byteswap(T x)
+{
+    auto b = std::bit_cast<std::array<char, sizeof(T)>>(x);
+    std::reverse(b.begin(), b.end());
+    return std::bit_cast<T>(b);
+}
+
+// Swap the bytes of n elements of size elsize.
+inline void
+binary_swap(char * p, dim_t n, std::size_t elsize)
+{
+    for (char * e=p+n*elsize; p<e; p+=elsize) {
+        std::reverse(p, p+elsize);
+    }
+}
+
+inline std::ostream &
+write_binary_header(std::ostream & o, BinaryHeader const & h)
+{
+    std::uint32_t const kind = h.kind;
+    std::int64_t const rank = h.rank();
+    o.write(binary_magic, 8);
+    o.write((char const *)&binary_order, 4);
+    o.write((char const *)&binary_version, 4);
+    o.write((char const *)&kind, 4);
+    o.write((char const *)&h.elsize, 4);
+    o.write((char const *)&rank, 8);
+    static_assert(sizeof(dim_t)==8);
+    o.write((char const *)h.shape.data(), 8*rank);
+    o.write((char const *)h.stride.data(), 8*rank);
+    return o;
+}
+
+// A header with a rank over this is taken as bad input.
+constexpr rank_t binary_max_rank = 64;
+
+// On failure, the stream's failbit is set. That includes a rank over max_rank, which is checked before the shape is
+// read, so a bad rank doesn't cause a large allocation.
+inline std::istream &
+read_binary_header(std::istream & i, BinaryHeader & h, rank_t max_rank=binary_max_rank)
+{
+    char magic[8];
+    std::uint32_t order, version, kind, elsize;
+    std::int64_t rank;
+    if (!i.read(magic, 8) || 0!=std::memcmp(magic, binary_magic, 8) || !i.read((char *)&order, 4)
+        || (order!=binary_order && order!=binary_byteswap(binary_order))) {
+        i.setstate(std::ios::failbit);
+        return i;
+    }
+    bool const swap = order!=binary_order;
+    auto fix = [&](auto & x) { if (swap) { x = binary_byteswap(x); } };
+    if (!i.read((char *)&version, 4) || (fix(version), version!=binary_version)
+        || !i.read((char *)&kind, 4) || !i.read((char *)&elsize, 4) || !i.read((char *)&rank, 8)
+        || (fix(kind), fix(elsize), fix(rank), rank<0 || rank>max_rank)) {
+        i.setstate(std::ios::failbit);
+        return i;
+    }
+    h.kind = kind;
+    h.elsize = elsize;
+    h.swap = swap;
+    h.shape.resize(rank);
+    h.stride.resize(rank);
+    if (i.read((char *)h.shape.data(), 8*rank) && i.read((char *)h.stride.data(), 8*rank)) {
+        for (rank_t k=0; k<rank; ++k) {
+            fix(h.shape[k]);
+            fix(h.stride[k]);
+            if (h.shape[k]<0) {
+                i.setstate(std::ios::failbit);
+            }
+        }
+    }
+    return i;
+}
+
+// The elements must be read as they were written, without conversion. Return false if they can't be.
+template <class T>
+inline bool
+check_binary_type(BinaryHeader const & h)
+{
+    return h.kind==binary_kind<T> && h.elsize==sizeof(T)
+        && (!h.swap || binary_kind<T>!='V') // can't swap bytes of structs.
+        && h.stride==binary_header<T>(h.shape).stride; // data must be in row-major order.
+}
+
+template <class A>
+constexpr bool
+binary_contiguous(A const & a)
+{
+    dim_t s = 1;
+    for (int k=a.rank()-1; k>=0; --k) {
+        if (a.size(k)==0) {
+            return true;
+        } else if (a.size(k)!=1 && s!=a.stride(k)) {
+            return false;
+        }
+        s *= a.size(k);
+    }
+    return true;
+}
+
+// Write the elements of a in row-major order. If a is contiguous in row-major order, this takes a single write,
+// otherwise the elements are gathered in chunks.
+template <class A>
+inline std::ostream &
+write_binary_data(std::ostream & o, A && a)
+{
+    using T = value_t<A>;
+    static_assert(std::is_trivially_copyable_v<T>, "binary output needs trivially copyable elements");
+    dim_t const n = ra::size(a);
+    if constexpr (requires { a.data(); a.stride(0); }) {
+        if (binary_contiguous(a)) {
+            return o.write((char const *)a.data(), n*sizeof(T));
+        }
+    }
+    if (n>0) {
+// not std::vector, because of bool.
+        dim_t const m = std::min(n, binary_chunk);
+        std::unique_ptr<T []> buffer(new T[m]);
+        dim_t k = 0;
+        for_each(ra::ordered, [&](auto const & x)
+                              {
+                                  buffer[k++] = x;
+                                  if (k==m) {
+                                      o.write((char const *)buffer.get(), k*sizeof(T));
+                                      k = 0;
+                                  }
+                              }, a);
+        o.write((char const *)buffer.get(), k*sizeof(T));
+    }
+    return o;
+}
+
+template <class A> requires (is_ra<A> || is_foreign_vector<A>)
+inline std::ostream &
+write_binary(std::ostream & o, A && a)
+{
+    auto const & sa = start(a);
+    std::vector<dim_t> s(sa.rank());
+    for (rank_t k=0; k<rank_t(s.size()); ++k) {
+        s[k] = sa.size(k);
+    }
+    if (write_binary_header(o, binary_header<value_t<A>>(s))) {
+        write_binary_data(o, a);
+    }
+    return o;
+}
+
+// Read n elements into p. With swap, reverse the bytes of each element (or of each part of a complex element).
+template <class T>
+inline std::istream &
+read_binary_block(std::istream & i, T * p, dim_t n, bool swap)
+{
+    if (i.read((char *)p, n*sizeof(T)) && swap) {
+        if constexpr ('c'==binary_kind<T>) {
+            binary_swap((char *)p, 2*n, sizeof(T)/2);
+        } else {
+            binary_swap((char *)p, n, sizeof(T));
+        }
+    }
+    return i;
+}
+
+// Read the elements of c in row-major order. If c is contiguous in row-major order, this takes a single read,
+// otherwise the elements are scattered in chunks.
+template <class C>
+inline std::istream &
+read_binary_data(std::istream & i, C && c, bool swap)
+{
+    using T = value_t<C>;
+    static_assert(std::is_trivially_copyable_v<T>, "binary input needs trivially copyable elements");
+    dim_t const n = ra::size(c);
+    if constexpr (requires { c.data(); c.stride(0); }) {
+        if (binary_contiguous(c)) {
+            return read_binary_block(i, c.data(), n, swap);
+        }
+    }
+    if (n>0) {
+        std::unique_ptr<T []> buffer(new T[std::min(n, binary_chunk)]);
+        dim_t k = 0, m = 0, left = n;
+        for_each(ra::ordered, [&](auto & x)
+                              {
+                                  if (k==m) {
+                                      m = std::min(left, binary_chunk);
+                                      left -= m;
+                                      read_binary_block(i, buffer.get(), m, swap);
+                                      k = 0;
+                                  }
+                                  x = buffer[k++];
+                              }, c);
+    }
+    return i;
+}
+
+// If c has var size, allocate it to shape s. Otherwise, s must be the shape of c. Return false if c can't have shape
+// s, before anything is allocated.
+template <class C>
+inline bool
+binary_resize(C & c, std::vector<dim_t> const & s)
+{
+    if constexpr (size_s<C>()==DIM_ANY) {
+        if (rank_s<C>()!=RANK_ANY && rank_s<C>()!=rank_t(s.size())) {
+            return false;
+        }
+        if constexpr (requires { c.store; }) {
+            C cc(s, ra::none);
+            swap(c, cc);
+        }
+    }
+    auto const & sc = start(c);
+    if (sc.rank()!=rank_t(s.size())) {
+        return false;
+    }
+    for (rank_t k=0; k<sc.rank(); ++k) {
+        if (sc.size(k)!=s[k]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// If c has var size, it's allocated to the shape in the input, and the elements are read directly into it.
+// Otherwise, the shape in the input must match that of c. If the header doesn't match c, the stream's failbit is set
+// and nothing is read.
+template <class C>
+inline std::istream &
+read_binary(std::istream & i, C & c)
+{
+    BinaryHeader h;
+    if (read_binary_header(i, h, rank_s<C>()==RANK_ANY ? binary_max_rank : rank_s<C>())) {
+        if (!check_binary_type<value_t<C>>(h) || !binary_resize(c, h.shape)) {
+            i.setstate(std::ios::failbit);
+        } else {
+            read_binary_data(i, c, h.swap);
+        }
+    }
+    return i;
+}
+
+} // namespace ra
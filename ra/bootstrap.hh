@@ -70,6 +70,27 @@ concept RaIterator = requires (A a, rank_t k, dim_t d, rank_t i, rank_t j)
     { a.flat() } -> FlatIterator<decltype(a.stride(k))>;
 };
 
+// keep_stride can be computed from the type alone, so plyf can find the compact dims at compile time.
+template <class A>
+concept StaticKeepStride = requires
+{
+    std::bool_constant<std::decay_t<A>::keep_stride(1, 0, 0)> {};
+};
+
+// Like a.adv(k, d), for any step d. Plain traversal only steps by 1 or turns back, and some leaves (e.g. Vector) check
+// that in adv(). The traversals that start at a chunk or a tile (ply_par, ply_tiled) use this, and those leaves and
+// the iterators that hold other iterators define jump().
+template <class A>
+constexpr void
+jump(A & a, rank_t k, dim_t d)
+{
+    if constexpr (requires { a.jump(k, d); }) {
+        a.jump(k, d);
+    } else {
+        a.adv(k, d);
+    }
+}
+
 
 // ---------------------
 // other types, forward decl
@@ -13,18 +13,21 @@
 
 namespace ra {
 
-template <class E> struct concrete_type_def_1;
+// Dynamic is the container for results of dynamic size. It's Big by default, or ArenaBig to take the storage from
+// the current Arena (see arena.hh). The functions below that make new arrays take it as an optional first template
+// argument, e.g. concrete<ArenaBig>(e) or gemm<ArenaBig>(a, b).
+template <class E, template <class, rank_t> class Dynamic> struct concrete_type_def_1;
 
-template <class E>
+template <class E, template <class, rank_t> class Dynamic>
 requires (size_s<E>()==DIM_ANY)
-struct concrete_type_def_1<E>
+struct concrete_type_def_1<E, Dynamic>
 {
-    using type = Big<value_t<E>, E::rank_s()>;
+    using type = Dynamic<value_t<E>, E::rank_s()>;
 };
 
-template <class E>
+template <class E, template <class, rank_t> class Dynamic>
 requires (size_s<E>()!=DIM_ANY)
-struct concrete_type_def_1<E>
+struct concrete_type_def_1<E, Dynamic>
 {
     template <class I> struct T;
     template <int ... I> struct T<mp::int_list<I ...>>
@@ -34,57 +37,74 @@ struct concrete_type_def_1<E>
     using type = typename T<mp::iota<E::rank_s()>>::type;
 };
 
-template <class E>
+template <class E, template <class, rank_t> class Dynamic=Big>
 struct concrete_type_def
 {
     using type = std::conditional_t<
         is_scalar<E>,
         E, // scalars are their own concrete_type.
-        typename concrete_type_def_1<std::decay_t<decltype(start(std::declval<E>()))>>::type>;
+        typename concrete_type_def_1<std::decay_t<decltype(start(std::declval<E>()))>, Dynamic>::type>;
 };
 
-template <class E> using concrete_type = std::decay_t<typename concrete_type_def<E>::type>;
-template <class E> inline auto concrete(E && e) { return concrete_type<E>(std::forward<E>(e)); }
+template <class E, template <class, rank_t> class Dynamic=Big>
+using concrete_type = std::decay_t<typename concrete_type_def<E, Dynamic>::type>;
+
+template <template <class, rank_t> class Dynamic=Big, class E> inline auto
+concrete(E && e)
+{
+    return concrete_type<E, Dynamic>(std::forward<E>(e));
+}
+
+// Like concrete, but a result of dynamic size takes its storage from the current Arena, if there is one.
+template <class E> inline auto
+arena_concrete(E && e)
+{
+    return concrete<ArenaBig>(std::forward<E>(e));
+}
 
 // FIXME replace ra_traits::make
 
-template <class E, class X> inline auto
+template <template <class, rank_t> class Dynamic=Big, class E, class X> inline auto
 with_same_shape(E && e, X && x)
 {
-    if constexpr (size_s<concrete_type<E>>()!=DIM_ANY) {
-        return concrete_type<E>(std::forward<X>(x));
+    using C = concrete_type<E, Dynamic>;
+    if constexpr (size_s<C>()!=DIM_ANY) {
+        return C(std::forward<X>(x));
     } else {
-        return concrete_type<E>(ra::shape(e), std::forward<X>(x));
+        return C(ra::shape(e), std::forward<X>(x));
     }
 }
 
-template <class E> inline auto
+template <template <class, rank_t> class Dynamic=Big, class E> inline auto
 with_same_shape(E && e)
 {
-    if constexpr (size_s<concrete_type<E>>()!=DIM_ANY) {
-        return concrete_type<E>();
+    using C = concrete_type<E, Dynamic>;
+    if constexpr (size_s<C>()!=DIM_ANY) {
+        return C();
     } else {
-        return concrete_type<E>(ra::shape(e), ra::none);
+        return C(ra::shape(e), ra::none);
     }
 }
 
-template <class E, class S, class X> inline auto
+template <class E, template <class, rank_t> class Dynamic=Big, class S, class X> inline auto
 with_shape(S && s, X && x)
 {
-    if constexpr (size_s<concrete_type<E>>()!=DIM_ANY) {
-        return concrete_type<E>(std::forward<X>(x));
+    using C = concrete_type<E, Dynamic>;
+    if constexpr (size_s<C>()!=DIM_ANY) {
+        return C(std::forward<X>(x));
     } else {
-        return concrete_type<E>(std::forward<S>(s), std::forward<X>(x));
+        return C(std::forward<S>(s), std::forward<X>(x));
     }
 }
 
-template <class E, class S, class X> inline auto
+template <class E, template <class, rank_t> class Dynamic=Big, class S, class X> inline auto
 with_shape(std::initializer_list<S> && s, X && x)
 {
-    if constexpr (size_s<concrete_type<E>>()!=DIM_ANY) {
-        return concrete_type<E>(std::forward<X>(x));
+    using C = concrete_type<E, Dynamic>;
+    if constexpr (size_s<C>()!=DIM_ANY) {
+        return C(std::forward<X>(x));
     } else {
-        return concrete_type<E>(s, std::forward<X>(x));
+        return C(s, std::forward<X>(x));
     }
 }
 
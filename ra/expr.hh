@@ -26,6 +26,18 @@ struct Flat<Op, T, mp::int_list<I ...>>
     constexpr decltype(auto) operator*() { return op(*std::get<I>(t) ...); }
 };
 
+template <class Op, class ... P, class I>
+struct unit_stride<Flat<Op, std::tuple<P ...>, I>>
+{
+    using type = std::tuple<unit_stride_t<P> ...>;
+};
+
+template <class Op, class ... P, class I>
+struct flat_first<Flat<Op, std::tuple<P ...>, I>>
+{
+    using type = typename flat_first<std::decay_t<mp::first<std::tuple<P ...>>>>::type;
+};
+
 template <class Op, class ... P> inline constexpr auto
 flat(Op & op, P && ... p)
 {
@@ -93,10 +105,20 @@ map(Op && op, A && ... a)
     return expr(std::forward<Op>(op), start(std::forward<A>(a)) ...);
 }
 
-template <class Op, class ... A> inline constexpr void
+template <class Op, class ... A>
+requires (!is_policy<Op>)
+inline constexpr void
 for_each(Op && op, A && ... a)
 {
     ply(map(std::forward<Op>(op), std::forward<A>(a) ...));
 }
 
+template <class Policy, class Op, class ... A>
+requires (is_policy<Policy>)
+inline constexpr void
+for_each(Policy const & policy, Op && op, A && ... a)
+{
+    ply(policy, map(std::forward<Op>(op), std::forward<A>(a) ...));
+}
+
 } // namespace ra
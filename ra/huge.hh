@@ -0,0 +1,111 @@
+// -*- mode: c++; coding: utf-8 -*-
+/// @file huge.hh
+/// @brief Storage for large arrays on huge pages.
+
+// This library is free software; you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option) any
+// later version.
+
+// POSIX only. Huge pages are only requested on Linux; elsewhere this is just page-aligned anonymous memory.
+
+#pragma once
+#include "ra/big.hh"
+#include <cstdint>
+#include <sys/mman.h>
+
+namespace ra {
+
+constexpr std::size_t huge_page_size = std::size_t(2) << 20;
+
+// Allocator for arrays of many pages. Blocks of at least huge_page_size bytes are mapped anonymously and aligned to
+// huge_page_size. With hugetlb, they're taken from the preallocated huge page pool (MAP_HUGETLB) if possible, and
+// otherwise they're advised for transparent huge pages (MADV_HUGEPAGE). Smaller blocks go to operator new.
+// Like default_init_allocator, it does default initialization, so the pages of a new Container aren't placed until
+// Container::init calls first_touch (see big.hh).
+template <class T, bool hugetlb=false>
+struct huge_allocator
+{
+    using value_type = T;
+    constexpr static bool first_touch = true;
+
+    template <class U> struct rebind { using other = huge_allocator<U, hugetlb>; };
+
+    huge_allocator() = default;
+    template <class U> constexpr huge_allocator(huge_allocator<U, hugetlb> const &) noexcept {}
+
+    constexpr static std::align_val_t alignment { std::max(std::size_t(64), alignof(T)) };
+    constexpr static bool mapped(std::size_t n) { return n*sizeof(T)>=huge_page_size; }
+    constexpr static std::size_t mapped_size(std::size_t n)
+    {
+        return (n*sizeof(T)+huge_page_size-1)/huge_page_size*huge_page_size;
+    }
+
+    T * allocate(std::size_t n)
+    {
+        T * p = allocate_(n);
+        track_alloc(p, n*sizeof(T));
+        return p;
+    }
+    T * allocate_(std::size_t n)
+    {
+        if (!mapped(n)) {
+            return static_cast<T *>(::operator new(n*sizeof(T), alignment));
+        }
+        std::size_t const len = mapped_size(n);
+#if defined(MAP_HUGETLB)
+        if constexpr (hugetlb) {
+            void * p = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (p!=MAP_FAILED) {
+                return static_cast<T *>(p);
+            }
+        }
+#endif
+// map one huge page more than needed, so that the start can be aligned, then unmap the excess.
+        void * b = mmap(nullptr, len+huge_page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (b==MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        char * const p = static_cast<char *>(b);
+        char * const q = p + (huge_page_size - std::uintptr_t(p) % huge_page_size) % huge_page_size;
+        if (q>p) {
+            munmap(p, q-p);
+        }
+        munmap(q+len, p+huge_page_size-q);
+#if defined(MADV_HUGEPAGE)
+        madvise(q, len, MADV_HUGEPAGE);
+#endif
+        return reinterpret_cast<T *>(q);
+    }
+    void deallocate(T * p, std::size_t n) noexcept
+    {
+        track_free(p);
+        if (mapped(n)) {
+            munmap(p, mapped_size(n));
+        } else {
+            ::operator delete(p, alignment);
+        }
+    }
+
+    template <class U>
+    void construct(U * ptr) noexcept(std::is_nothrow_default_constructible<U>::value)
+    {
+        ::new(static_cast<void *>(ptr)) U;
+    }
+    template <class U, class ... A>
+    void construct(U * ptr, A && ... a)
+    {
+        ::new(static_cast<void *>(ptr)) U(std::forward<A>(a) ...);
+    }
+
+    template <class U> constexpr bool operator==(huge_allocator<U, hugetlb> const &) const { return true; }
+    template <class U> constexpr bool operator!=(huge_allocator<U, hugetlb> const &) const { return false; }
+};
+
+// Like Big, but on huge pages, and placed by first touch with the partition and the chunk-to-thread mapping of
+// ply(par, ...). For NUMA placement, the pool of par should be pinned across the nodes (see ThreadPool), and the
+// array should be traversed from the thread that made it, which runs the first chunk.
+template <class T, rank_t RANK=RANK_ANY, bool hugetlb=false>
+using Huge = Container<std::vector<T, huge_allocator<T, hugetlb>>, RANK>;
+
+} // namespace ra
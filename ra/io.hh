@@ -13,50 +13,227 @@
 #include "ra/format.hh"
 #include "ra/concrete.hh"
 #include <iosfwd>
+#include <string>
 #include <sstream>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <optional>
 
 namespace ra {
 
+// Elements that are read with std::from_chars and written with std::to_chars. Character types are read and written
+// as characters by std::iostream, so they aren't included.
+template <class T> constexpr bool text_fast = std::is_arithmetic_v<T> && !std::is_same_v<T, bool>
+    && !std::is_same_v<T, char> && !std::is_same_v<T, signed char> && !std::is_same_v<T, unsigned char>;
+
+// How write_text formats arithmetic elements with std::to_chars. For floating point elements, precision<0 gives the
+// shortest text that reads back exactly. Integers are always written in full.
+struct TextFormat
+{
+    std::chars_format fmt = std::chars_format::general;
+    int precision = 6;
+};
+
+// The format that o would use for arithmetic elements, unless o has settings that std::to_chars can't reproduce.
+inline std::optional<TextFormat>
+text_format(std::ios_base const & o)
+{
+    auto const flags = o.flags();
+    auto const ff = flags & std::ios::floatfield;
+    auto const bf = flags & std::ios::basefield;
+    if ((flags & (std::ios::showpos | std::ios::showpoint | std::ios::uppercase)) || (bf && bf!=std::ios::dec)
+        || ff==(std::ios::fixed | std::ios::scientific) || o.width()!=0 || o.getloc()!=std::locale::classic()) {
+        return std::nullopt;
+    }
+    return TextFormat { ff==std::ios::fixed ? std::chars_format::fixed
+                        : ff==std::ios::scientific ? std::chars_format::scientific
+                        : std::chars_format::general,
+                        o.precision()<0 ? 6 : int(o.precision()) };
+}
+
+// Write straight to the stream buffer, in large blocks, without the sentry or the locale of formatted output.
+struct TextWriter
+{
+    std::streambuf & out;
+    TextFormat f;
+    bool bad = false;
+    int n = 0;
+    char buf[1<<15];
+
+    void flush()
+    {
+        bad = bad || out.sputn(buf, n)!=n;
+        n = 0;
+    }
+    void text(char const * s, std::size_t len)
+    {
+        while (len>0) {
+            if (n==int(sizeof(buf))) {
+                flush();
+            }
+            std::size_t const k = std::min(len, sizeof(buf)-n);
+            std::copy(s, s+k, buf+n);
+            n += k;
+            s += k;
+            len -= k;
+        }
+    }
+    void text(char const * s) { text(s, std::strlen(s)); }
+    template <class T>
+    void element(T const & x)
+    {
+// retry once on an empty buffer.
+        for (int retry=0; retry<2; ++retry) {
+            std::to_chars_result r;
+            if constexpr (std::is_floating_point_v<T>) {
+                r = f.precision<0
+                    ? std::to_chars(buf+n, std::end(buf), x, f.fmt)
+                    : std::to_chars(buf+n, std::end(buf), x, f.fmt, f.precision);
+            } else {
+                r = std::to_chars(buf+n, std::end(buf), x);
+            }
+            if (r.ec==std::errc()) {
+                n = r.ptr-buf;
+                return;
+            }
+            flush();
+        }
+        bad = true;
+    }
+};
+
+// Formatted output, for elements that aren't text_fast or for streams that TextWriter can't imitate.
+struct StreamWriter
+{
+    std::ostream & o;
+
+    void text(char const * s) { o << s; }
+    template <class T> void element(T const & x) { o << x; }
+};
+
+// Separator between two elements, after the last k axes wrap.
+template <class W, class A>
+inline void
+text_sep(W & w, FormatArray<A> const & fa, int k)
+{
+    switch (k) {
+    case 0: w.text(fa.sep0); break;
+    case 1: w.text(fa.sep1); break;
+    default: for (int i=0; i<k; ++i) { w.text(fa.sep2); }
+    }
+}
+
+// Write the elements of a in row-major order, for [0 rows) of axis 0 and all of the other axes. Return a where it
+// started.
 // TODO merge with ply_ravel @ ply.hh. But should control order.
+template <class W, class A, class S, class B>
+inline void
+text_walk(W & w, A & a, S const & sha, dim_t rows, FormatArray<B> const & fa)
+{
+    rank_t const rank = a.rank();
+    auto ind = with_same_shape(sha, 0);
+    for (;;) {
+        w.element(*(a.flat()));
+        for (int k=0; ; ++k) {
+            if (k>=rank) {
+                return;
+            }
+            dim_t const nk = k==rank-1 ? rows : sha[rank-1-k];
+            if (ind[rank-1-k]<nk-1) {
+                ++ind[rank-1-k];
+                a.adv(rank-1-k, 1);
+                text_sep(w, fa, k);
+                break;
+            } else {
+                ind[rank-1-k] = 0;
+                a.adv(rank-1-k, 1-nk);
+            }
+        }
+    }
+}
+
+// Elements per slab in parallel write_text.
+constexpr dim_t text_slab = 1<<16;
+
+// Write fa as operator<< does, but with arithmetic elements formatted by std::to_chars as f says. Without f, use
+// the formatting of o. With a parallel policy, slabs of axis 0 are formatted in parallel, a round of threads at a
+// time, and written in order. This only applies to arithmetic elements formatted with f.
 template <class A>
 inline std::ostream &
-operator<<(std::ostream & o, FormatArray<A> const & fa)
+write_text(std::ostream & o, FormatArray<A> const & fa, std::optional<TextFormat> const & f, par_t const & policy=par(1))
 {
 // FIXME note that this copies / resets the RaIterator if fa.a already is one; see [ra35].
     auto a = ra::start(fa.a);
     static_assert(size_s(a)!=DIM_BAD, "cannot print type");
     rank_t const rank = a.rank();
     auto sha = concrete(shape(a));
-    auto ind = with_same_shape(sha, 0);
     if (withshape==fa.shape || (defaultshape==fa.shape && size_s(a)==DIM_ANY)) {
         o << start(sha) << '\n';
     }
+    dim_t len = 1;
     for (rank_t k=0; k<rank; ++k) {
         if (sha[k]==0) {
             return o;
         }
+        len *= sha[k];
     }
-// order here is row-major on purpose.
-    for (;;) {
-        o << *(a.flat());
-        for (int k=0; ; ++k) {
-            if (k>=rank) {
+    dim_t const n = rank>0 ? sha[0] : 1;
+    if constexpr (text_fast<std::decay_t<decltype(*(a.flat()))>>) {
+        if (f) {
+            std::ostream::sentry sentry(o);
+            if (!sentry) {
                 return o;
-            } else if (ind[rank-1-k]<sha[rank-1-k]-1) {
-                ++ind[rank-1-k];
-                a.adv(rank-1-k, 1);
-                switch (k) {
-                case 0: o << fa.sep0; break;
-                case 1: o << fa.sep1; break;
-                default: std::fill_n(std::ostream_iterator<char const *>(o, ""), k, fa.sep2);
-                }
-                break;
+            }
+            TextWriter w { *o.rdbuf(), *f };
+            int const m = int(std::min(dim_t(policy.threads()), n));
+            if (m<2) {
+                text_walk(w, a, sha, n, fa);
             } else {
-                ind[rank-1-k] = 0;
-                a.adv(rank-1-k, 1-sha[rank-1-k]);
+// FIXME iterators that are held by reference in a (see [ra35]) are shared among the threads.
+                dim_t const rows = std::max(dim_t(1), text_slab/(len/n));
+                struct Part { std::string s; bool bad; };
+                std::vector<Part> part(m);
+                for (dim_t b=0; b<n; b+=rows*m) {
+                    dim_t const e = std::min(n, b+rows*m);
+                    int const mb = int(std::min(dim_t(m), e-b));
+                    policy.pool().run(mb, [&](int t)
+                                          {
+                                              dim_t const bt = b+par_split(e-b, mb, t);
+                                              std::stringbuf sb;
+                                              TextWriter wt { sb, *f };
+                                              auto c = a;
+                                              jump(c, 0, bt);
+                                              text_walk(wt, c, sha, b+par_split(e-b, mb, t+1)-bt, fa);
+                                              wt.flush();
+                                              part[t] = Part { std::move(sb).str(), wt.bad };
+                                          });
+                    for (int t=0; t<mb; ++t) {
+                        if (b>0 || t>0) {
+                            text_sep(w, fa, rank-1);
+                        }
+                        w.text(part[t].s.data(), part[t].s.size());
+                        w.bad = w.bad || part[t].bad;
+                    }
+                }
+            }
+            w.flush();
+            if (w.bad) {
+                o.setstate(std::ios::badbit);
             }
+            return o;
         }
     }
+    StreamWriter w { o };
+    text_walk(w, a, sha, n, fa);
+    return o;
+}
+
+template <class A>
+inline std::ostream &
+operator<<(std::ostream & o, FormatArray<A> const & fa)
+{
+    return write_text(o, fa, text_format(o));
 }
 
 // is_foreign_vector is included b/c std::vector or std::array may be used as the type of shape().
@@ -75,12 +252,279 @@ operator<<(std::ostream & o, std::initializer_list<T> const & a)
     return o << format_array(a);
 }
 
+// Position and description of a failure to read text input. Lines and columns count from 1.
+struct TextError
+{
+    dim_t line = 0, column = 0;
+    std::string what;
+    explicit operator bool() const { return !what.empty(); }
+};
+
+inline std::ostream &
+operator<<(std::ostream & o, TextError const & e)
+{
+    return o << "line " << e.line << ", column " << e.column << ": " << e.what;
+}
+
+inline bool text_space(char c) { return std::isspace((unsigned char)c); }
+
+// Parse all of [b e) into x. Unlike std::from_chars, accept a leading +, as std::istream does.
+template <class T>
+inline bool
+text_parse(char const * b, char const * e, T & x)
+{
+    if (e-b>1 && *b=='+' && b[1]!='-') {
+        ++b;
+    }
+    auto [p, ec] = std::from_chars(b, e, x);
+    return ec==std::errc() && p==e;
+}
+
+// Read whitespace separated numbers straight from the stream buffer, without the sentry or the locale of formatted
+// input. Nothing is read beyond the end of the last number. line and column are those of the next character.
+struct TextReader
+{
+    std::streambuf & in;
+    dim_t line = 1, column = 1;
+    bool eof = false;
+
+    int peek()
+    {
+        int c = in.sgetc();
+        eof = (c==std::char_traits<char>::eof());
+        return c;
+    }
+    void bump(int c)
+    {
+        in.sbumpc();
+        if (c=='\n') {
+            ++line;
+            column = 1;
+        } else {
+            ++column;
+        }
+    }
+    template <class T>
+    bool get(T & x, TextError & e)
+    {
+        int c;
+        while (c=peek(), !eof && std::isspace(c)) {
+            bump(c);
+        }
+        dim_t const l = line, col = column;
+// tokens that don't fit in token go on in longer.
+        char token[128];
+        std::string longer;
+        int n = 0;
+        while (c=peek(), !eof && !std::isspace(c)) {
+            if (n==int(sizeof(token))) {
+                longer.append(token, n);
+                n = 0;
+            }
+            token[n++] = c;
+            bump(c);
+        }
+        if (!longer.empty()) {
+            longer.append(token, n);
+        }
+        char const * b = longer.empty() ? token : longer.data();
+        char const * end = longer.empty() ? token+n : longer.data()+longer.size();
+        if (b==end) {
+            e = TextError { l, col, "unexpected end of input" };
+            return false;
+        } else if (!text_parse(b, end, x)) {
+            e = TextError { l, col, std::string("cannot read '").append(b, end).append("'") };
+            return false;
+        }
+        return true;
+    }
+};
+
+// For var size c, read the shape, and allocate c to it unless it has that shape already and its storage isn't shared
+// with other arrays, which mustn't be overwritten.
+template <class C>
+inline TextError
+read_text_shape(TextReader & r, C & c)
+{
+    TextError e;
+    if constexpr (size_s<C>()==DIM_ANY) {
+        decltype(shape(c)) s;
+        dim_t const l = r.line, col = r.column;
+        if constexpr (requires { s.resize(0); }) {
+            if (dim_t n; !r.get(n, e)) {
+                return e;
+            } else if (n<0) {
+                return TextError { l, col, "negative sizes in input" };
+            } else {
+                s.resize(n);
+            }
+        }
+        for (auto & k: s) {
+            if (!r.get(k, e)) {
+                return e;
+            }
+        }
+        if (!every(start(s)>=0)) {
+            return TextError { l, col, "negative sizes in input" };
+        }
+        bool shared = false;
+        if constexpr (requires { c.store.use_count(); }) {
+            shared = (1!=c.store.use_count());
+        }
+        if (shared || dim_t(start(s).size(0))!=ra::rank(c) || !every(start(s)==start(shape(c)))) {
+            std::decay_t<C> cc(s, ra::none);
+// avoid copying in case Container's elements don't support it.
+            swap(c, cc);
+        }
+    }
+    return e;
+}
+
+// Read the elements of c in row-major order.
+template <class C>
+inline TextError
+read_text_elements(std::istream & i, TextReader & r, C & c)
+{
+    TextError e;
+    if constexpr (text_fast<std::decay_t<decltype(*std::begin(c))>>) {
+        for (auto & ci: c) {
+            if (!r.get(ci, e)) {
+                break;
+            }
+        }
+    } else {
+        for (auto & ci: c) { i >> ci; }
+        if (!i) {
+            e = TextError { 0, 0, "cannot read element" };
+        }
+    }
+    return e;
+}
+
+// Read c as operator>> does. On failure, set the stream's failbit and return the error. Positions are counted from
+// where the read starts. They're only known for elements of arithmetic type.
+template <class C>
+inline TextError
+read_text(std::istream & i, C & c)
+{
+    if (!i.good()) {
+        i.setstate(std::ios::failbit);
+        return TextError { 0, 0, "bad stream" };
+    }
+    TextReader r { *i.rdbuf() };
+    TextError e = read_text_shape(r, c);
+    if (!e) {
+        e = read_text_elements(i, r, c);
+    }
+    i.setstate((r.eof ? std::ios::eofbit : std::ios::goodbit) | (e ? std::ios::failbit : std::ios::goodbit));
+    return e;
+}
+
+// Like read_text(i, c), but the elements are parsed in parallel chunks. This reads the rest of the stream, so it's
+// meant for input that holds a single array. c must be contiguous in row-major order and have arithmetic elements,
+// otherwise this is read_text(i, c).
+template <class C>
+inline TextError
+read_text(std::istream & i, C & c, par_t const & policy)
+{
+    using T = std::decay_t<decltype(*std::begin(c))>;
+    if constexpr (!(text_fast<T> && requires { c.data(); is_c_order(c); })) {
+        return read_text(i, c);
+    } else {
+        if (!i.good()) {
+            i.setstate(std::ios::failbit);
+            return TextError { 0, 0, "bad stream" };
+        }
+        TextReader r { *i.rdbuf() };
+        TextError e = read_text_shape(r, c);
+        if (e || !is_c_order(c)) {
+            if (!e) {
+                e = read_text_elements(i, r, c);
+            }
+            i.setstate((r.eof ? std::ios::eofbit : std::ios::goodbit) | (e ? std::ios::failbit : std::ios::goodbit));
+            return e;
+        }
+        std::string const s((std::istreambuf_iterator<char>(&r.in)), std::istreambuf_iterator<char>());
+        i.setstate(std::ios::eofbit);
+        dim_t const len = s.size(), n = ra::size(c);
+        int const m = int(std::max(dim_t(1), std::min(dim_t(policy.threads()), len/4096)));
+// chunks end on whitespace, so that no number is split.
+        std::vector<dim_t> cut(m+1, len);
+        for (int t=0; t<m; ++t) {
+            cut[t] = par_split(len, m, t);
+            while (t>0 && cut[t]<len && !text_space(s[cut[t]])) {
+                ++cut[t];
+            }
+        }
+// first pass: numbers and newlines of each chunk, so that each chunk knows where it starts.
+        struct Chunk { dim_t count = 0, lines = 0, last = -1, line = 0, column = 0, first = 0; TextError e; };
+        std::vector<Chunk> chunk(m);
+        policy.pool().run(m, [&](int t)
+                              {
+                                  Chunk & k = chunk[t];
+                                  for (dim_t j=cut[t]; j<cut[t+1]; ++j) {
+                                      if (s[j]=='\n') {
+                                          ++k.lines;
+                                          k.last = j;
+                                      }
+                                      k.count += !text_space(s[j]) && (j==cut[t] || text_space(s[j-1]));
+                                  }
+                              });
+        chunk[0].line = r.line;
+        chunk[0].column = r.column;
+        for (int t=1; t<m; ++t) {
+            Chunk const & k = chunk[t-1];
+            chunk[t].first = k.first + k.count;
+            chunk[t].line = k.line + k.lines;
+            chunk[t].column = k.lines>0 ? cut[t]-k.last : k.column + (cut[t]-cut[t-1]);
+        }
+        if (chunk[m-1].first+chunk[m-1].count<n) {
+            Chunk const & k = chunk[m-1];
+            e = TextError { k.line + k.lines, k.lines>0 ? len-k.last : k.column + (len-cut[m-1]), "unexpected end of input" };
+        } else {
+            T * p = c.data();
+            policy.pool().run(m, [&](int t)
+                                  {
+                                      Chunk & k = chunk[t];
+                                      dim_t line = k.line, column = k.column;
+                                      for (dim_t j=cut[t], q=k.first; j<cut[t+1] && q<n; ) {
+                                          if (s[j]=='\n') {
+                                              ++line;
+                                              column = 1;
+                                              ++j;
+                                          } else if (text_space(s[j])) {
+                                              ++column;
+                                              ++j;
+                                          } else {
+                                              dim_t b = j;
+                                              while (j<cut[t+1] && !text_space(s[j])) {
+                                                  ++j;
+                                              }
+                                              if (!text_parse(s.data()+b, s.data()+j, p[q++])) {
+                                                  k.e = TextError { line, column, std::string("cannot read '").append(s, b, j-b).append("'") };
+                                                  return;
+                                              }
+                                              column += j-b;
+                                          }
+                                      }
+                                  });
+            for (int t=0; t<m && !e; ++t) {
+                e = chunk[t].e;
+            }
+        }
+        if (e) {
+            i.setstate(std::ios::failbit);
+        }
+        return e;
+    }
+}
+
 // Static size.
 template <class C> requires (!is_scalar<C> && size_s<C>()!=DIM_ANY)
 inline std::istream &
 operator>>(std::istream & i, C & c)
 {
-    for (auto & ci: c) { i >> ci; }
+    read_text(i, c);
     return i;
 }
 
@@ -89,27 +533,31 @@ template <class T, class A>
 inline std::istream &
 operator>>(std::istream & i, std::vector<T, A> & c)
 {
-    if (dim_t n; !((i >> n).fail())) {
-        RA_CHECK(n>=0 && "negative sizes in input");
-        c.resize(n);
-        for (auto & ci: c) { i >> ci; }
+    if (!i.good()) {
+        i.setstate(std::ios::failbit);
+        return i;
+    }
+    TextReader r { *i.rdbuf() };
+    TextError e;
+    dim_t const l = r.line, col = r.column;
+    if (dim_t n; r.get(n, e)) {
+        if (n<0) {
+            e = TextError { l, col, "negative sizes in input" };
+        } else {
+            c.resize(n);
+            e = read_text_elements(i, r, c);
+        }
     }
+    i.setstate((r.eof ? std::ios::eofbit : std::ios::goodbit) | (e ? std::ios::failbit : std::ios::goodbit));
     return i;
 }
 
-// Expr size, so read shape and possibly allocate (TODO try to avoid).
+// Expr size, so read shape and possibly allocate.
 template <class C> requires (size_s<C>()==DIM_ANY)
 inline std::istream &
 operator>>(std::istream & i, C & c)
 {
-    if (decltype(shape(c)) s; i >> s) {
-        std::decay_t<C> cc(s, ra::none);
-        RA_CHECK(every(start(s)>=0) && "negative sizes in input");
-// avoid copying in case Container's elements don't support it.
-        swap(c, cc);
-// need row-major, serial iteration here. FIXME use ra:: traversal.
-        for (auto & ci: c) { i >> ci; }
-    }
+    read_text(i, c);
     return i;
 }
 
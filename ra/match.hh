@@ -242,11 +242,19 @@ struct Match<std::tuple<P ...>, mp::int_list<I ...>>
     {
         (std::get<I>(t).adv(k, d), ...);
     }
+    constexpr void jump(rank_t k, dim_t d)
+    {
+        (ra::jump(std::get<I>(t), k, d), ...);
+    }
 
-    constexpr bool keep_stride(dim_t st, int z, int j) const
+    constexpr bool keep_stride(dim_t st, int z, int j) const requires (!(StaticKeepStride<P> && ...))
     {
         return (std::get<I>(t).keep_stride(st, z, j) && ...);
     }
+    constexpr static bool keep_stride(dim_t st, int z, int j) requires (StaticKeepStride<P> && ...)
+    {
+        return (std::decay_t<P>::keep_stride(st, z, j) && ...);
+    }
 
     constexpr auto stride(int i) const
     {
@@ -0,0 +1,228 @@
+// -*- mode: c++; coding: utf-8 -*-
+/// @file mmap.hh
+/// @brief Arrays backed by memory-mapped files.
+
+// This library is free software; you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option) any
+// later version.
+
+// POSIX only. The file is a small header followed by the array in row-major order:
+// [magic (8)] [version (4)] [sizeof(T) (4)] [rank (8)] [size (8) ...] [padding to mmap_align] [data ...]
+
+#pragma once
+#include "ra/big.hh"
+#include "ra/format.hh"
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <stdexcept>
+#include <system_error>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace ra {
+
+constexpr char mmap_magic[8] = {'r', 'a', ':', ':', 'm', 'm', 'a', 'p'};
+constexpr std::uint32_t mmap_version = 1;
+constexpr std::size_t mmap_align = 64;
+
+enum class mmap_advice { normal, sequential, random, willneed, dontneed };
+
+inline int
+mmap_advice_flag(mmap_advice a)
+{
+    switch (a) {
+    case mmap_advice::sequential: return MADV_SEQUENTIAL;
+    case mmap_advice::random: return MADV_RANDOM;
+    case mmap_advice::willneed: return MADV_WILLNEED;
+    case mmap_advice::dontneed: return MADV_DONTNEED;
+    default: return MADV_NORMAL;
+    }
+}
+
+// Deleter for the store of a mapped array. It keeps the whole mapping, including the header.
+struct MmapDeleter
+{
+    void * base;
+    std::size_t len;
+    template <class T> void operator()(T * p) { munmap(base, len); }
+};
+
+// Bad files and failed system calls are reported with an exception, whether RA_CHECK is enabled or not.
+template <class ... A>
+[[noreturn]] inline void
+mmap_error(A && ... a)
+{
+    throw std::runtime_error(format(a ...));
+}
+
+template <class ... A>
+[[noreturn]] inline void
+mmap_system_error(A && ... a)
+{
+    throw std::system_error(errno, std::generic_category(), format(a ...));
+}
+
+// File descriptor that's closed at the end of the scope.
+struct MmapFd
+{
+    int fd;
+    MmapFd(char const * name, int flags, mode_t mode=0): fd(open(name, flags, mode))
+    {
+        if (fd<0) {
+            mmap_system_error("cannot open ", name);
+        }
+    }
+    MmapFd(MmapFd const &) = delete;
+    MmapFd & operator=(MmapFd const &) = delete;
+    ~MmapFd() { close(fd); }
+};
+
+// Map the file at name, which must have at least min_len bytes. The mapping is undone at the end of the scope, unless
+// it's released. Its length is in get_deleter().len.
+inline std::unique_ptr<char, MmapDeleter>
+mmap_map(char const * name, std::size_t min_len, bool ro)
+{
+    MmapFd f(name, ro ? O_RDONLY : O_RDWR);
+    struct stat st;
+    if (0!=fstat(f.fd, &st)) {
+        mmap_system_error("cannot stat ", name);
+    }
+    if (std::size_t(st.st_size)<min_len) {
+        mmap_error("file ", name, " is too short");
+    }
+    std::size_t const len = st.st_size;
+    void * base = mmap(nullptr, len, ro ? PROT_READ : PROT_READ | PROT_WRITE, MAP_SHARED, f.fd, 0);
+    if (base==MAP_FAILED) {
+        mmap_system_error("cannot map ", name);
+    }
+    return std::unique_ptr<char, MmapDeleter>(static_cast<char *>(base), MmapDeleter { base, len });
+}
+
+constexpr std::size_t
+mmap_data_offset(rank_t rank)
+{
+    return (8+4+4+8+8*std::size_t(rank)+mmap_align-1)/mmap_align*mmap_align;
+}
+
+// Map the file at name, with a header written by mmap_create. If T is const, the file is mapped read-only, otherwise
+// writes to the array go to the file.
+template <class T, rank_t RANK=RANK_ANY>
+inline Shared<T, RANK>
+mmap_open(char const * name, mmap_advice advice=mmap_advice::normal)
+{
+    constexpr bool ro = std::is_const_v<T>;
+    auto m = mmap_map(name, mmap_data_offset(0), ro);
+    std::size_t const len = m.get_deleter().len;
+    char const * h = m.get();
+    std::uint32_t version, elsize;
+    std::int64_t rank;
+    std::memcpy(&version, h+8, 4);
+    std::memcpy(&elsize, h+12, 4);
+    std::memcpy(&rank, h+16, 8);
+    if (0!=std::memcmp(h, mmap_magic, 8) || version!=mmap_version) {
+        mmap_error("bad header in ", name);
+    }
+    if (elsize!=sizeof(T)) {
+        mmap_error("element size ", elsize, " in ", name, " should be ", sizeof(T));
+    }
+    if (rank<0 || std::uint64_t(rank)>(len-24)/8 || len<mmap_data_offset(rank)) {
+        mmap_error("bad header in ", name);
+    }
+    if (RANK!=RANK_ANY && rank!=RANK) {
+        mmap_error("rank ", rank, " in ", name, " should be ", RANK);
+    }
+    std::vector<dim_t> s(rank);
+    std::memcpy(s.data(), h+24, 8*rank);
+    std::size_t n = 1;
+    for (dim_t k: s) {
+        if (k<0 || (k>0 && n>(len-mmap_data_offset(rank))/sizeof(T)/k)) {
+            mmap_error("file ", name, " is too short");
+        }
+        n *= k;
+    }
+    T * p = reinterpret_cast<T *>(m.get()+mmap_data_offset(rank));
+    if (advice!=mmap_advice::normal && 0!=madvise(m.get(), len, mmap_advice_flag(advice))) {
+        mmap_system_error("madvise failed on ", name);
+    }
+    Shared<T, RANK> a;
+    a.dim = View<T, RANK>(s, p).dim;
+    a.p = p;
+    MmapDeleter const d = m.get_deleter();
+    m.release(); // the shared_ptr constructor calls d if it throws.
+    a.store = std::shared_ptr<T>(p, d);
+    return a;
+}
+
+// Create the file at name for an array of shape s, and map it read-write. The contents are zero.
+template <class T, rank_t RANK=RANK_ANY, class S>
+inline Shared<T, RANK>
+mmap_create(char const * name, S const & s, mmap_advice advice=mmap_advice::normal)
+{
+    static_assert(!std::is_const_v<T>, "cannot create read-only mapping");
+    static_assert(std::is_trivially_copyable_v<T>, "mapped arrays need trivially copyable elements");
+    std::vector<dim_t> sv(start(s).size(0));
+    start(sv) = s;
+    std::int64_t rank = sv.size();
+    RA_CHECK(RANK==RANK_ANY || rank==RANK, "rank ", rank, " should be ", RANK);
+    std::size_t n = 1;
+    for (dim_t k: sv) {
+        RA_CHECK(k>=0, "bad size ", k);
+        n *= k;
+    }
+    std::vector<char> h(mmap_data_offset(rank), 0);
+    std::uint32_t elsize = sizeof(T);
+    std::memcpy(h.data(), mmap_magic, 8);
+    std::memcpy(h.data()+8, &mmap_version, 4);
+    std::memcpy(h.data()+12, &elsize, 4);
+    std::memcpy(h.data()+16, &rank, 8);
+    std::memcpy(h.data()+24, sv.data(), 8*rank);
+    {
+        MmapFd f(name, O_RDWR | O_CREAT | O_TRUNC, 0666);
+        if (ssize_t(h.size())!=pwrite(f.fd, h.data(), h.size(), 0) || 0!=ftruncate(f.fd, h.size()+n*sizeof(T))) {
+            mmap_system_error("cannot write ", name);
+        }
+    }
+    return mmap_open<T, RANK>(name, advice);
+}
+
+template <class T, rank_t RANK=RANK_ANY>
+inline Shared<T, RANK>
+mmap_create(char const * name, std::initializer_list<dim_t> s, mmap_advice advice=mmap_advice::normal)
+{
+    return mmap_create<T, RANK>(name, std::vector<dim_t>(s), advice);
+}
+
+// Write the changes to a mapped array to its file. With wait, return only after they're written.
+template <class T, rank_t RANK>
+inline void
+mmap_sync(Shared<T, RANK> const & a, bool wait=true)
+{
+    MmapDeleter const * d = std::get_deleter<MmapDeleter>(a.store);
+    if (!d) {
+        mmap_error("array isn't mapped");
+    }
+    if (0!=msync(d->base, d->len, wait ? MS_SYNC : MS_ASYNC)) {
+        mmap_system_error("msync failed");
+    }
+}
+
+// Change the expected traversal pattern of a mapped array.
+template <class T, rank_t RANK>
+inline void
+mmap_advise(Shared<T, RANK> const & a, mmap_advice advice)
+{
+    MmapDeleter const * d = std::get_deleter<MmapDeleter>(a.store);
+    if (!d) {
+        mmap_error("array isn't mapped");
+    }
+    if (0!=madvise(d->base, d->len, mmap_advice_flag(advice))) {
+        mmap_system_error("madvise failed");
+    }
+}
+
+} // namespace ra
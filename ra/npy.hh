@@ -0,0 +1,517 @@
+// -*- mode: c++; coding: utf-8 -*-
+/// @file npy.hh
+/// @brief Read and write NumPy .npy and .npz files.
+
+// This library is free software; you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option) any
+// later version.
+
+// See https://numpy.org/doc/stable/reference/generated/numpy.lib.format.html. An .npz file is a zip archive of .npy
+// files. Only stored (uncompressed) archives are supported, as made by numpy.savez, but not numpy.savez_compressed.
+// npy_open is POSIX only.
+
+#pragma once
+#include "ra/binary.hh"
+#include "ra/mmap.hh"
+#include <array>
+#include <string>
+#include <fstream>
+#include <charconv>
+
+namespace ra {
+
+constexpr char npy_magic[6] = {'\x93', 'N', 'U', 'M', 'P', 'Y'};
+constexpr std::size_t npy_align = 64;
+
+// Type descriptor, e.g. '<f8'. The kinds of binary_kind are the same as NumPy's.
+template <class T>
+inline std::string
+npy_descr()
+{
+    char const order = (1==sizeof(T) || 'V'==binary_kind<T>) ? '|' : std::endian::native==std::endian::little ? '<' : '>';
+    return std::string { order, binary_kind<T> } + std::to_string(sizeof(T));
+}
+
+struct NpyHeader
+{
+    std::string descr;
+    bool fortran = false;
+    std::vector<dim_t> shape;
+
+    dim_t size() const { dim_t s = 1; for (dim_t k: shape) { s *= k; } return s; }
+// the data was written with the opposite byte order.
+    bool swap() const
+    {
+        return descr.size()>0 && descr[0]==(std::endian::native==std::endian::little ? '>' : '<');
+    }
+};
+
+inline std::ostream &
+write_npy_header(std::ostream & o, NpyHeader const & h)
+{
+    std::string d = "{'descr': '" + h.descr + "', 'fortran_order': " + (h.fortran ? "True" : "False") + ", 'shape': (";
+    for (dim_t s: h.shape) {
+        d += std::to_string(s) + ", ";
+    }
+    if (1==h.shape.size()) {
+        d.pop_back();
+    } else if (h.shape.size()>1) {
+        d.resize(d.size()-2);
+    }
+    d += "), }";
+// pad with spaces and end with a newline, so that the data is aligned.
+    std::size_t const v1 = (6+2+2+d.size()+1+npy_align-1)/npy_align*npy_align;
+    bool const v2 = v1-10>0xffff;
+    std::size_t const total = v2 ? (6+2+4+d.size()+1+npy_align-1)/npy_align*npy_align : v1;
+    std::size_t const len = total-(v2 ? 12 : 10);
+    d.resize(len-1, ' ');
+    d += '\n';
+    char const version[2] = { char(v2 ? 2 : 1), 0 };
+    char const lenb[4] = { char(len & 0xff), char((len>>8) & 0xff), char((len>>16) & 0xff), char((len>>24) & 0xff) };
+    o.write(npy_magic, 6).write(version, 2).write(lenb, v2 ? 4 : 2);
+    return o.write(d.data(), d.size());
+}
+
+// On failure, the stream's failbit is set.
+inline std::istream &
+read_npy_header(std::istream & i, NpyHeader & h)
+{
+    auto fail = [&i]() -> std::istream & { i.setstate(std::ios::failbit); return i; };
+    char magic[6];
+    unsigned char version[2], lenb[4] = {0, 0, 0, 0};
+    if (!i.read(magic, 6) || 0!=std::memcmp(magic, npy_magic, 6) || !i.read((char *)version, 2)
+        || version[0]<1 || version[0]>3 || !i.read((char *)lenb, version[0]==1 ? 2 : 4)) {
+        return fail();
+    }
+    std::string d(lenb[0] | (lenb[1]<<8) | (std::size_t(lenb[2])<<16) | (std::size_t(lenb[3])<<24), ' ');
+    if (!i.read(d.data(), d.size())) {
+        return fail();
+    }
+// the value for key, up to the first of end.
+    auto value = [&d](char const * key, char const * end) -> std::string
+                 {
+                     std::size_t a = d.find(key);
+                     if (a==std::string::npos || (a=d.find(':', a))==std::string::npos) {
+                         return "";
+                     }
+                     a = d.find_first_not_of(" ", a+1);
+                     std::size_t b = d.find_first_of(end, a+1);
+                     return (a==std::string::npos || b==std::string::npos) ? "" : d.substr(a, b+1-a);
+                 };
+    std::string descr = value("'descr'", "'\""), fortran = value("'fortran_order'", ",}"), shape = value("'shape'", ")");
+    if (descr.size()<3 || shape.size()<2 || shape[0]!='(') {
+        return fail();
+    }
+    h.descr = descr.substr(1, descr.size()-2);
+    h.fortran = (0==fortran.find("True"));
+    h.shape.clear();
+    for (char const * p=shape.data()+1, * e=shape.data()+shape.size()-1; ; ) {
+        while (p<e && (*p==' ' || *p==',')) {
+            ++p;
+        }
+        if (p==e) {
+            break;
+        }
+        dim_t s;
+        auto [q, ec] = std::from_chars(p, e, s);
+        if (ec!=std::errc() || s<0) {
+            return fail();
+        }
+        h.shape.push_back(s);
+        p = q;
+    }
+    return i;
+}
+
+// The elements must be read as they were written, without conversion. Return false if they can't be.
+template <class T>
+inline bool
+check_npy_type(NpyHeader const & h)
+{
+    std::string const descr = npy_descr<T>();
+    return h.descr.substr(1)==descr.substr(1) && (1==sizeof(T) || h.descr[0]!='|' || descr[0]=='|')
+        && (!h.swap() || binary_kind<T>!='V'); // can't swap bytes of structs.
+}
+
+// Dope vector for the data of h in memory, in row-major order, or as its transpose with fortran.
+inline std::vector<Dim>
+npy_dims(NpyHeader const & h)
+{
+    std::vector<Dim> dims(h.shape.size());
+    dim_t s = 1;
+    for (std::size_t j=0; j<dims.size(); ++j) {
+        std::size_t const k = h.fortran ? j : dims.size()-1-j;
+        dims[k] = Dim { h.shape[k], s };
+        s *= h.shape[k];
+    }
+    return dims;
+}
+
+// a can be any array expression. If a is contiguous in column-major order (e.g. transpose of a Big) but not in
+// row-major order, it's written as such, with fortran_order set. Otherwise it's written in row-major order.
+template <class A> requires (is_ra<A> || is_foreign_vector<A>)
+inline std::ostream &
+write_npy(std::ostream & o, A && a)
+{
+    using T = value_t<A>;
+    auto const & sa = start(a);
+    NpyHeader h { npy_descr<T>(), false, std::vector<dim_t>(sa.rank()) };
+    for (rank_t k=0; k<sa.rank(); ++k) {
+        h.shape[k] = sa.size(k);
+    }
+    if constexpr (requires { a.data(); a.dim; }) {
+        if (!binary_contiguous(a)) {
+            h.fortran = true;
+            std::vector<Dim> const dims = npy_dims(h);
+            if (std::equal(dims.begin(), dims.end(), a.dim.begin(),
+                           [](Dim const & x, Dim const & y) { return x.size==y.size && x.stride==y.stride; })) {
+                return write_npy_header(o, h).write((char const *)a.data(), h.size()*sizeof(T));
+            }
+            h.fortran = false;
+        }
+    }
+    if (write_npy_header(o, h)) {
+        write_binary_data(o, a);
+    }
+    return o;
+}
+
+// If c has var size, it's allocated to the shape in the input, and the elements are read directly into it.
+// Otherwise, the shape in the input must match that of c. Data in Fortran order is read into the transpose of c, which
+// must then have a data() and a dope vector. If the header doesn't match c, the stream's failbit is set and nothing is
+// read.
+template <class C>
+inline std::istream &
+read_npy(std::istream & i, C & c)
+{
+    using T = value_t<C>;
+    NpyHeader h;
+    if (!read_npy_header(i, h)) {
+        return i;
+    }
+    constexpr bool transposable = requires { c.data(); c.dim; };
+    if (!check_npy_type<T>(h) || (h.fortran && h.shape.size()>1 && !transposable) || !binary_resize(c, h.shape)) {
+        i.setstate(std::ios::failbit);
+        return i;
+    }
+    if (h.fortran && h.shape.size()>1) {
+        if constexpr (transposable) {
+            std::vector<Dim> dims(c.dim.begin(), c.dim.end());
+            std::reverse(dims.begin(), dims.end());
+            read_binary_data(i, View<T, rank_s<C>()> (dims, c.data()), h.swap());
+        }
+    } else {
+        read_binary_data(i, c, h.swap());
+    }
+    return i;
+}
+
+// Map the .npy file at name, without copying. Data in Fortran order is mapped as a transposed View. If T is const,
+// the file is mapped read-only, otherwise writes to the array go to the file. The data must be in native byte order.
+template <class T, rank_t RANK=RANK_ANY>
+inline Shared<T, RANK>
+npy_open(char const * name, mmap_advice advice=mmap_advice::normal)
+{
+    constexpr bool ro = std::is_const_v<T>;
+    NpyHeader h;
+    std::ifstream f(name, std::ios::binary);
+    if (!read_npy_header(f, h)) {
+        mmap_error("bad header in ", name);
+    }
+    if (!check_npy_type<std::remove_const_t<T>>(h)) {
+        mmap_error("type ", h.descr, " in ", name, " should be ", npy_descr<std::remove_const_t<T>>());
+    }
+    if (h.swap()) {
+        mmap_error("cannot map ", name, " with foreign byte order");
+    }
+    if (RANK!=RANK_ANY && rank_t(h.shape.size())!=RANK) {
+        mmap_error("rank ", h.shape.size(), " in ", name, " should be ", RANK);
+    }
+    std::size_t const offset = f.tellg();
+    f.close();
+    auto m = mmap_map(name, offset, ro);
+    std::size_t const len = m.get_deleter().len;
+    std::size_t n = 1;
+    for (dim_t k: h.shape) {
+        if (k>0 && n>(len-offset)/sizeof(T)/k) {
+            mmap_error("file ", name, " is too short");
+        }
+        n *= k;
+    }
+    if (advice!=mmap_advice::normal && 0!=madvise(m.get(), len, mmap_advice_flag(advice))) {
+        mmap_system_error("madvise failed on ", name);
+    }
+    T * p = reinterpret_cast<T *>(m.get()+offset);
+    Shared<T, RANK> a;
+    a.dim = View<T, RANK>(npy_dims(h), p).dim;
+    a.p = p;
+    MmapDeleter const d = m.get_deleter();
+    m.release(); // the shared_ptr constructor calls d if it throws.
+    a.store = std::shared_ptr<T>(p, d);
+    return a;
+}
+
+// CRC-32 as used by zip.
+constexpr auto crc32_table = []
+{
+    std::array<std::uint32_t, 256> t {};
+    for (std::uint32_t n=0; n<256; ++n) {
+        std::uint32_t c = n;
+        for (int k=0; k<8; ++k) {
+            c = (c & 1) ? 0xedb88320u ^ (c>>1) : (c>>1);
+        }
+        t[n] = c;
+    }
+    return t;
+}();
+
+// Stream buffer that forwards output to another, and keeps the CRC-32 and the size of what went through.
+struct CrcBuf: public std::streambuf
+{
+    std::streambuf * out;
+    std::uint32_t crc = 0xffffffffu;
+    std::size_t size = 0;
+
+    explicit CrcBuf(std::streambuf * out_): out(out_) {}
+    std::streamsize xsputn(char const * s, std::streamsize n) override
+    {
+        for (std::streamsize k=0; k<n; ++k) {
+            crc = crc32_table[(crc ^ (unsigned char)s[k]) & 0xff] ^ (crc>>8);
+        }
+        size += n;
+        return out->sputn(s, n);
+    }
+    int_type overflow(int_type c) override
+    {
+        if (traits_type::eq_int_type(c, traits_type::eof())) {
+            return traits_type::not_eof(c);
+        }
+        char const x = traits_type::to_char_type(c);
+        return 1==xsputn(&x, 1) ? c : traits_type::eof();
+    }
+    std::uint32_t value() const { return crc ^ 0xffffffffu; }
+};
+
+// Little endian integers for zip headers.
+template <int N>
+inline void
+zip_put(std::string & s, std::uint64_t x)
+{
+    for (int k=0; k<N; ++k) {
+        s += char((x>>(8*k)) & 0xff);
+    }
+}
+
+inline std::uint64_t
+zip_get(char const * p, int n)
+{
+    std::uint64_t x = 0;
+    for (int k=n-1; k>=0; --k) {
+        x = (x<<8) | (unsigned char)(p[k]);
+    }
+    return x;
+}
+
+// Write arrays with add(), then finish with close(). The stream must be seekable, e.g. a std::ofstream in binary
+// mode, because the sizes of each file are patched after it's written.
+struct NpzWriter
+{
+    struct Entry { std::string name; std::uint32_t crc; std::uint64_t size, offset; };
+
+    std::ostream & o;
+    std::vector<Entry> entries;
+
+    explicit NpzWriter(std::ostream & o_): o(o_) {}
+    NpzWriter(NpzWriter const &) = delete;
+    NpzWriter & operator=(NpzWriter const &) = delete;
+
+    static std::string local_header(Entry const & e)
+    {
+        std::string h;
+        zip_put<4>(h, 0x04034b50);
+        zip_put<2>(h, 20); // version needed
+        zip_put<2>(h, 0);  // flags
+        zip_put<2>(h, 0);  // stored
+        zip_put<2>(h, 0);  // time
+        zip_put<2>(h, 0x21); // date 1980-01-01
+        zip_put<4>(h, e.crc);
+        zip_put<4>(h, e.size);
+        zip_put<4>(h, e.size);
+        zip_put<2>(h, e.name.size());
+        zip_put<2>(h, 0);
+        return h + e.name;
+    }
+
+// Add a as key.npy. Without zip64, files and offsets must be under 4 GiB. If they aren't, or the writing fails, o's
+// failbit is set and the file isn't added.
+    template <class A>
+    NpzWriter & add(std::string const & key, A && a)
+    {
+        Entry e { key + ".npy", 0, 0, std::uint64_t(o.tellp()) };
+        if (!o || e.offset>=0xffffffffu) {
+            o.setstate(std::ios::failbit);
+            return *this;
+        }
+        o << local_header(e);
+        CrcBuf buf(o.rdbuf());
+        std::ostream os(&buf);
+        write_npy(os, a);
+        if (!os || buf.size>=0xffffffffu) {
+            o.setstate(std::ios::failbit);
+            return *this;
+        }
+        e.crc = buf.value();
+        e.size = buf.size;
+        std::streampos const end = o.tellp();
+        o.seekp(e.offset);
+        o << local_header(e);
+        o.seekp(end);
+        entries.push_back(e);
+        return *this;
+    }
+
+// Write the central directory. If it doesn't fit without zip64, o's failbit is set and nothing is written.
+    void close()
+    {
+        std::uint64_t const start = o.tellp();
+        if (!o || start>=0xffffffffu || entries.size()>=0xffffu) {
+            o.setstate(std::ios::failbit);
+            return;
+        }
+        std::string d;
+        for (Entry const & e: entries) {
+            zip_put<4>(d, 0x02014b50);
+            zip_put<2>(d, 20); // version made by
+            d += local_header(e).substr(4, 26);
+            zip_put<2>(d, 0);  // comment length
+            zip_put<2>(d, 0);  // disk
+            zip_put<2>(d, 0);  // internal attributes
+            zip_put<4>(d, 0);  // external attributes
+            zip_put<4>(d, e.offset);
+            d += e.name;
+        }
+        std::size_t const size = d.size();
+        zip_put<4>(d, 0x06054b50);
+        zip_put<4>(d, 0);
+        zip_put<2>(d, entries.size());
+        zip_put<2>(d, entries.size());
+        zip_put<4>(d, size);
+        zip_put<4>(d, start);
+        zip_put<2>(d, 0);
+        o << d;
+    }
+};
+
+// Names of the files in the archive, and the offsets of their local headers. On failure, the stream's failbit is set
+// and no files are returned. Every field is checked against the bytes that hold it before it's used.
+inline std::vector<std::pair<std::string, std::uint64_t>>
+npz_directory(std::istream & i)
+{
+    using Files = std::vector<std::pair<std::string, std::uint64_t>>;
+    Files files;
+    auto fail = [&i]() { i.setstate(std::ios::failbit); return Files {}; };
+    if (!i.seekg(0, std::ios::end)) {
+        return fail();
+    }
+    std::uint64_t const size = i.tellg();
+    std::uint64_t const tail = std::min<std::uint64_t>(size, 22+0xffff);
+    std::string t(tail, 0);
+    if (!i.seekg(size-tail) || !i.read(t.data(), tail)) {
+        return fail();
+    }
+    std::size_t const e = t.rfind("PK\x05\x06");
+    if (e==std::string::npos || e+22>t.size()) {
+        return fail();
+    }
+    std::uint64_t n = zip_get(t.data()+e+10, 2), dsize = zip_get(t.data()+e+12, 4), dstart = zip_get(t.data()+e+16, 4);
+// zip64 end of central directory, through its locator.
+    if (dstart==0xffffffffu || n==0xffff) {
+        std::string z(56, 0);
+        if (e<20 || 0!=t.compare(e-20, 4, "PK\x06\x07") || !i.seekg(zip_get(t.data()+e-20+8, 8))
+            || !i.read(z.data(), 56) || 0!=z.compare(0, 4, "PK\x06\x06")) {
+            return fail();
+        }
+        n = zip_get(z.data()+32, 8);
+        dsize = zip_get(z.data()+40, 8);
+        dstart = zip_get(z.data()+48, 8);
+    }
+    if (dsize>size || dstart>size-dsize) {
+        return fail();
+    }
+    std::string d(dsize, 0);
+    if (!i.seekg(dstart) || !i.read(d.data(), dsize)) {
+        return fail();
+    }
+    for (std::size_t p=0; n>0; --n) {
+// compressed files aren't supported.
+        if (p+46>d.size() || 0!=d.compare(p, 4, "PK\x01\x02") || 0!=zip_get(d.data()+p+10, 2)) {
+            return fail();
+        }
+        std::size_t const lname = zip_get(d.data()+p+28, 2), lextra = zip_get(d.data()+p+30, 2);
+        std::size_t const lcomment = zip_get(d.data()+p+32, 2);
+        if (p+46+lname+lextra+lcomment>d.size()) {
+            return fail();
+        }
+        std::uint64_t offset = zip_get(d.data()+p+42, 4);
+        if (offset==0xffffffffu) {
+// the zip64 extra holds only the fields that overflowed, in the order uncompressed size, compressed size, offset.
+            std::size_t const skip = 8*(0xffffffffu==zip_get(d.data()+p+24, 4)) + 8*(0xffffffffu==zip_get(d.data()+p+20, 4));
+            bool found = false;
+            for (std::size_t x=p+46+lname, xe=x+lextra; x+4<=xe; ) {
+                std::size_t const id = zip_get(d.data()+x, 2), len = zip_get(d.data()+x+2, 2);
+                if (x+4+len>xe || (1==id && len<skip+8)) {
+                    return fail();
+                }
+                if (1==id) {
+                    offset = zip_get(d.data()+x+4+skip, 8);
+                    found = true;
+                }
+                x += 4+len;
+            }
+            if (!found) {
+                return fail();
+            }
+        }
+        files.emplace_back(d.substr(p+46, lname), offset);
+        p += 46+lname+lextra+lcomment;
+    }
+    return files;
+}
+
+// Names of the arrays in the archive.
+inline std::vector<std::string>
+npz_keys(std::istream & i)
+{
+    std::vector<std::string> keys;
+    for (auto const & [name, offset]: npz_directory(i)) {
+        keys.push_back(name.size()>4 && 0==name.compare(name.size()-4, 4, ".npy") ? name.substr(0, name.size()-4) : name);
+    }
+    return keys;
+}
+
+// Read the array key from the archive into c, as read_npy would. If there's no such array, the stream's failbit is set.
+template <class C>
+inline std::istream &
+read_npz(std::istream & i, std::string const & key, C & c)
+{
+    auto const files = npz_directory(i);
+    if (!i) {
+        return i;
+    }
+    for (auto const & [name, offset]: files) {
+        if (name==key+".npy" || name==key) {
+            char h[30];
+            if (!i.seekg(offset) || !i.read(h, 30) || 0!=std::memcmp(h, "PK\x03\x04", 4)) {
+                i.setstate(std::ios::failbit);
+                return i;
+            }
+            i.seekg(offset+30+zip_get(h+26, 2)+zip_get(h+28, 2));
+            return read_npy(i, c);
+        }
+    }
+    i.setstate(std::ios::failbit);
+    return i;
+}
+
+} // namespace ra
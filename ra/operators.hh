@@ -265,6 +265,20 @@ every(A && a)
     return early(map([](bool x) { return std::make_tuple(!x, x); }, std::forward<A>(a)), true);
 }
 
+template <class Policy, class A> requires (is_policy<Policy>)
+inline bool
+any(Policy const & policy, A && a)
+{
+    return early(policy, map([](bool x) { return std::make_tuple(x, x); }, std::forward<A>(a)), false);
+}
+
+template <class Policy, class A> requires (is_policy<Policy>)
+inline bool
+every(Policy const & policy, A && a)
+{
+    return early(policy, map([](bool x) { return std::make_tuple(!x, x); }, std::forward<A>(a)), true);
+}
+
 // FIXME variable rank? see J 'index of' (x i. y), etc.
 template <class A>
 inline auto index(A && a)
@@ -284,36 +298,76 @@ inline bool lexicographical_compare(A && a, B && b)
                  false);
 }
 
+// Reduce a with red (see Reduction in ply.hh). Dynamic size expressions are traversed with ply_reduce, which
+// uses several accumulators. With policy ra::par, each thread gets its own partial result.
+template <class Red, class A>
+inline constexpr decltype(Red::id)
+reduce(Red const & red, A && a)
+{
+    using T = decltype(Red::id);
+    if constexpr (size_s<start_t<A>>()==DIM_ANY) {
+        return ply_reduce(ra::start(std::forward<A>(a)), red);
+    } else {
+        T c = red.id;
+        for_each([&c, &red](auto && a) { c = red.op(c, a); }, std::forward<A>(a));
+        return c;
+    }
+}
+
+template <class Policy, class Red, class A>
+requires (is_policy<Policy>)
+inline decltype(Red::id)
+reduce(Policy const & policy, Red const & red, A && a)
+{
+    if constexpr (std::is_same_v<Policy, par_t> && size_s<start_t<A>>()==DIM_ANY) {
+        return ply_par_reduce(ra::start(std::forward<A>(a)), red, policy);
+    } else {
+        return reduce(red, std::forward<A>(a));
+    }
+}
+
+// Define name(a) and name(policy, a) as reductions by red.
+#define DEF_REDUCTION(name, red)                                        \
+    template <class A>                                                  \
+    inline constexpr auto name(A && a)                                  \
+    {                                                                   \
+        return reduce(red, std::forward<A>(a));                         \
+    }                                                                   \
+    template <class Policy, class A> requires (is_policy<Policy>)       \
+    inline auto name(Policy const & policy, A && a)                     \
+    {                                                                   \
+        return reduce(policy, red, std::forward<A>(a));                 \
+    }
+
 // FIXME only works with numeric types.
 using std::min;
-template <class A>
-inline auto amin(A && a)
+template <class T>
+constexpr auto amin_reduction()
 {
-    using T = value_t<A>;
-    T c = std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max();
-    for_each([&c](auto && a) { if (a<c) { c = a; } }, a);
-    return c;
+    return reduction(std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max(),
+                     [](T const & c, auto && a) -> T { return a<c ? a : c; });
 }
+DEF_REDUCTION(amin, amin_reduction<value_t<A>>())
 
 using std::max;
-template <class A>
-inline auto amax(A && a)
+template <class T>
+constexpr auto amax_reduction()
 {
-    using T = value_t<A>;
-    T c = std::numeric_limits<T>::has_infinity ? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::lowest();
-    for_each([&c](auto && a) { if (c<a) { c = a; } }, a);
-    return c;
+    return reduction(std::numeric_limits<T>::has_infinity ? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::lowest(),
+                     [](T const & c, auto && a) -> T { return c<a ? a : c; });
 }
+DEF_REDUCTION(amax, amax_reduction<value_t<A>>())
 
 // FIXME encapsulate this kind of reference-reduction.
 // FIXME expr/ply mechanism doesn't allow partial iteration (adv then continue).
+// Traverse in row-major order so that ties give the first element.
 template <class A, class Less = std::less<value_t<A>>>
 inline decltype(auto) refmin(A && a, Less && less = std::less<value_t<A>>())
 {
     RA_CHECK(a.size()>0);
     decltype(auto) s = ra::start(a);
     auto p = &(*s.flat());
-    for_each([&less, &p](auto & a) { if (less(a, *p)) { p = &a; } }, s);
+    for_each(ra::ordered, [&less, &p](auto & a) { if (less(a, *p)) { p = &a; } }, s);
     return *p;
 }
 
@@ -323,44 +377,138 @@ inline decltype(auto) refmax(A && a, Less && less = std::less<value_t<A>>())
     RA_CHECK(a.size()>0);
     decltype(auto) s = ra::start(a);
     auto p = &(*s.flat());
-    for_each([&less, &p](auto & a) { if (less(*p, a)) { p = &a; } }, s);
+    for_each(ra::ordered, [&less, &p](auto & a) { if (less(*p, a)) { p = &a; } }, s);
     return *p;
 }
 
-template <class A>
-inline constexpr auto sum(A && a)
+template <class T>
+constexpr auto sum_reduction()
 {
-    value_t<A> c {};
-    for_each([&c](auto && a) { c += a; }, a);
-    return c;
+    return reduction(T {}, [](T const & c, auto && a) -> T { return c+a; });
 }
+DEF_REDUCTION(sum, sum_reduction<value_t<A>>())
 
-template <class A>
-inline constexpr auto prod(A && a)
+template <class T>
+constexpr auto prod_reduction()
 {
-    value_t<A> c(1.);
-    for_each([&c](auto && a) { c *= a; }, a);
-    return c;
+    return reduction(T(1.), [](T const & c, auto && a) -> T { return c*a; });
+}
+DEF_REDUCTION(prod, prod_reduction<value_t<A>>())
+
+#undef DEF_REDUCTION
+
+// Compensated (Kahan) accumulator. s-c is the running sum, c the part of it that was lost in s.
+// Note that -ffast-math will undo the compensation.
+template <class T>
+struct KahanSum
+{
+    T s {}, c {};
+
+    constexpr void add(T const & x)
+    {
+        T y = x-c;
+        T t = s+y;
+        c = (t-s)-y;
+        s = t;
+    }
+    constexpr KahanSum operator+(T const & x) const { KahanSum k = *this; k.add(x); return k; }
+    constexpr KahanSum operator+(KahanSum const & b) const { KahanSum k = *this; k.add(b.s); k.add(-b.c); return k; }
+    constexpr T value() const { return s-c; }
+};
+
+template <class T>
+constexpr auto kahan_reduction()
+{
+    return reduction(KahanSum<T> {}, [](KahanSum<T> const & c, auto && a) -> KahanSum<T> { return c+a; });
+}
+
+// Sums with smaller error than sum, for long dynamic size expressions. The error of sum_pairwise grows as log(n),
+// that of sum_kahan doesn't grow with n. Both work in any traversal order and with any policy.
+template <class A> inline auto sum_pairwise(A && a) { return reduce(PairwiseSum<value_t<A>> {}, a); }
+template <class Policy, class A> requires (is_policy<Policy>)
+inline auto sum_pairwise(Policy const & policy, A && a) { return reduce(policy, PairwiseSum<value_t<A>> {}, a); }
+
+template <class A> inline auto sum_kahan(A && a) { return reduce(kahan_reduction<value_t<A>>(), a).value(); }
+template <class Policy, class A> requires (is_policy<Policy>)
+inline auto sum_kahan(Policy const & policy, A && a) { return reduce(policy, kahan_reduction<value_t<A>>(), a).value(); }
+
+template <class A, class B>
+inline auto dot_pairwise(A && a, B && b)
+{
+    using T = std::decay_t<decltype(FLAT(a) * FLAT(b))>;
+    return sum_pairwise(map([](auto && a, auto && b) -> T { return a*b; }, a, b));
+}
+
+template <class Policy, class A, class B> requires (is_policy<Policy>)
+inline auto dot_pairwise(Policy const & policy, A && a, B && b)
+{
+    using T = std::decay_t<decltype(FLAT(a) * FLAT(b))>;
+    return sum_pairwise(policy, map([](auto && a, auto && b) -> T { return a*b; }, a, b));
+}
+
+template <class A, class B>
+inline auto dot_kahan(A && a, B && b)
+{
+    using T = std::decay_t<decltype(FLAT(a) * FLAT(b))>;
+    return sum_kahan(map([](auto && a, auto && b) -> T { return a*b; }, a, b));
+}
+
+template <class Policy, class A, class B> requires (is_policy<Policy>)
+inline auto dot_kahan(Policy const & policy, A && a, B && b)
+{
+    using T = std::decay_t<decltype(FLAT(a) * FLAT(b))>;
+    return sum_kahan(policy, map([](auto && a, auto && b) -> T { return a*b; }, a, b));
 }
 
 template <class A> inline auto reduce_sqrm(A && a) { return sum(sqrm(a)); }
+template <class Policy, class A> requires (is_policy<Policy>)
+inline auto reduce_sqrm(Policy const & policy, A && a) { return sum(policy, sqrm(a)); }
 
 template <class A> inline auto norm2(A && a) { return std::sqrt(reduce_sqrm(a)); }
+template <class Policy, class A> requires (is_policy<Policy>)
+inline auto norm2(Policy const & policy, A && a) { return std::sqrt(reduce_sqrm(policy, a)); }
 
+// Dynamic size dot products are reduced with several accumulators, so fma is only used for the static size ones.
 template <class A, class B>
 inline auto dot(A && a, B && b)
 {
-    std::decay_t<decltype(FLAT(a) * FLAT(b))> c(0.);
-    for_each([&c](auto && a, auto && b) { c = fma(a, b, c); }, a, b);
-    return c;
+    using T = std::decay_t<decltype(FLAT(a) * FLAT(b))>;
+    auto ab = map([](auto && a, auto && b) -> T { return a*b; }, a, b);
+    if constexpr (size_s<decltype(ab)>()==DIM_ANY) {
+        return sum(std::move(ab));
+    } else {
+        T c(0.);
+        for_each([&c](auto && a, auto && b) { c = fma(a, b, c); }, a, b);
+        return c;
+    }
+}
+
+template <class Policy, class A, class B> requires (is_policy<Policy>)
+inline auto dot(Policy const & policy, A && a, B && b)
+{
+    using T = std::decay_t<decltype(FLAT(a) * FLAT(b))>;
+    return sum(policy, map([](auto && a, auto && b) -> T { return a*b; }, a, b));
 }
 
 template <class A, class B>
 inline auto cdot(A && a, B && b)
 {
-    std::decay_t<decltype(conj(FLAT(a)) * FLAT(b))> c(0.);
-    for_each([&c](auto && a, auto && b) { c = fma_conj(a, b, c); }, a, b);
-    return c;
+    using T = std::decay_t<decltype(conj(FLAT(a)) * FLAT(b))>;
+    auto ab = map([](auto && a, auto && b) -> T { return conj(a)*b; }, a, b);
+    if constexpr (size_s<decltype(ab)>()==DIM_ANY) {
+        return sum(std::move(ab));
+    } else {
+        T c(0.);
+        for_each([&c](auto && a, auto && b) { c = fma_conj(a, b, c); }, a, b);
+        return c;
+    }
+}
+
+template <class Policy, class A, class B> requires (is_policy<Policy>)
+inline auto cdot(Policy const & policy, A && a, B && b)
+{
+    using T = std::decay_t<decltype(conj(FLAT(a)) * FLAT(b))>;
+    return sum(policy, map([](auto && a, auto && b) -> T { return conj(a)*b; }, a, b));
 }
 
 // --------------------
@@ -468,18 +616,19 @@ inline auto perp(V const & v, U const & n)
 // Other whole-array ops.
 // --------------------
 
-template <class A>
+// For Dynamic, here and in gemm, gevm and gemv, see concrete_type.
+template <template <class, rank_t> class Dynamic=Big, class A>
 requires (is_slice<A>)
 inline auto normv(A const & a)
 {
-    return concrete(a/norm2(a));
+    return concrete<Dynamic>(a/norm2(a));
 }
 
-template <class A>
+template <template <class, rank_t> class Dynamic=Big, class A>
 requires (!is_slice<A> && is_ra<A>)
 inline auto normv(A const & a)
 {
-    auto b = concrete(a);
+    auto b = concrete<Dynamic>(a);
     b /= norm2(b);
     return b;
 }
@@ -496,7 +645,7 @@ gemm(A const & a, B const & b, C & c)
 #define MMTYPE decltype(from(times(), a(ra::all, 0), b(0, ra::all)))
 
 // default for row-major x row-major. See bench-gemm.cc for variants.
-template <class S, class T>
+template <template <class, rank_t> class Dynamic=Big, class S, class T>
 inline auto
 gemm(ra::View<S, 2> const & a, ra::View<T, 2> const & b)
 {
@@ -504,7 +653,7 @@ gemm(ra::View<S, 2> const & a, ra::View<T, 2> const & b)
     int const N = b.size(1);
     int const K = a.size(1);
 // no with_same_shape b/c cannot index 0 for type if A/B are empty
-    auto c = with_shape<MMTYPE>({M, N}, decltype(a(0, 0)*b(0, 0))());
+    auto c = with_shape<MMTYPE, Dynamic>({M, N}, decltype(a(0, 0)*b(0, 0))());
     for (int k=0; k<K; ++k) {
         c += from(times(), a(ra::all, k), b(k, ra::all));
     }
@@ -512,7 +661,7 @@ gemm(ra::View<S, 2> const & a, ra::View<T, 2> const & b)
 }
 
 // we still want the Small version to be different.
-template <class A, class B>
+template <template <class, rank_t> class Dynamic=Big, class A, class B>
 inline ra::Small<std::decay_t<decltype(FLAT(std::declval<A>()) * FLAT(std::declval<B>()))>, A::size(0), B::size(1)>
 gemm(A const & a, B const & b)
 {
@@ -530,14 +679,14 @@ gemm(A const & a, B const & b)
 
 #undef MMTYPE
 
-template <class A, class B>
+template <template <class, rank_t> class Dynamic=Big, class A, class B>
 inline auto
 gevm(A const & a, B const & b)
 {
     int const M = b.size(0);
     int const N = b.size(1);
 // no with_same_shape b/c cannot index 0 for type if A/B are empty
-    auto c = with_shape<decltype(a[0]*b(0, ra::all))>({N}, 0);
+    auto c = with_shape<decltype(a[0]*b(0, ra::all)), Dynamic>({N}, 0);
     for (int i=0; i<M; ++i) {
         c += a[i]*b(i);
     }
@@ -545,14 +694,14 @@ gevm(A const & a, B const & b)
 }
 
 // FIXME a must be a view, so it doesn't work with e.g. gemv(conj(a), b).
-template <class A, class B>
+template <template <class, rank_t> class Dynamic=Big, class A, class B>
 inline auto
 gemv(A const & a, B const & b)
 {
     int const M = a.size(0);
     int const N = a.size(1);
 // no with_same_shape b/c cannot index 0 for type if A/B are empty
-    auto c = with_shape<decltype(a(ra::all, 0)*b[0])>({M}, 0);
+    auto c = with_shape<decltype(a(ra::all, 0)*b[0]), Dynamic>({M}, 0);
     for (int j=0; j<N; ++j) {
         c += a(ra::all, j) * b[j];
     }
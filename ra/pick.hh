@@ -109,6 +109,12 @@ struct PickFlat<std::tuple<P0, P ...>, mp::int_list<I ...>>
     decltype(auto) operator*() { return pick_star<0>(*std::get<0>(t), t); }
 };
 
+template <class ... P, class I>
+struct unit_stride<PickFlat<std::tuple<P ...>, I>>
+{
+    using type = std::tuple<unit_stride_t<P> ...>;
+};
+
 template <class P0, class ... P> inline constexpr auto
 pick_flat(P0 && p0, P && ... p)
 {
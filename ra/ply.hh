@@ -8,11 +8,19 @@
 // Software Foundation; either version 3 of the License, or (at your option) any
 // later version.
 
-// TODO Lots of room for improvement: small (fixed sizes) and large (tiling, etc. see eval.cc in Blitz++).
+// TODO Lots of room for improvement: small (fixed sizes) and large (see eval.cc in Blitz++).
 
 #pragma once
 #include "ra/atom.hh"
+#include "ra/pool.hh"
 #include <functional>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <cstdint>
+#include <atomic>
+#include <optional>
+#include <memory>
 
 namespace ra {
 
@@ -21,30 +29,196 @@ namespace ra {
 // Run time order
 // --------------
 
+// Flatten the strides of the leaves of an expression, as returned by stride(k), into out.
+template <class S> constexpr int stride_leaves = 1;
+template <class ... S> constexpr int stride_leaves<std::tuple<S ...>> = (0 + ... + stride_leaves<S>);
+
+template <class S>
+constexpr dim_t *
+stride_flatten(S const & s, dim_t * out)
+{
+    if constexpr (mp::is_tuple_v<S>) {
+        std::apply([&out](auto const & ... si) { ((out = stride_flatten(si, out)), ...); }, s);
+        return out;
+    } else {
+        *out = s;
+        return out+1;
+    }
+}
+
+// Stride of the first leaf, cf flat_first.
+template <class S>
+constexpr dim_t
+stride_first(S const & s)
+{
+    if constexpr (mp::is_tuple_v<S>) {
+        return stride_first(std::get<0>(s));
+    } else {
+        return s;
+    }
+}
+
+// Static stride of flat iterator F on an axis where all of its leaves have stride 1. Scalar always has stride 0.
+// Specialized for Flat (expr.hh) and PickFlat (pick.hh), whose strides are tuples.
+template <class F> struct unit_stride { using type = mp::int_t<1>; };
+template <class C> struct unit_stride<ScalarFlat<C>> { using type = mp::int_t<0>; };
+template <class F> using unit_stride_t = typename unit_stride<std::decay_t<F>>::type;
+
+template <class U, class S>
+constexpr bool
+is_unit_stride(S const & s)
+{
+    if constexpr (stride_leaves<U> != stride_leaves<S>) {
+        return false;
+    } else {
+        dim_t u[stride_leaves<U>], v[stride_leaves<S>];
+        stride_flatten(U {}, u);
+        stride_flatten(s, v);
+        return std::equal(u, u+stride_leaves<U>, v);
+    }
+}
+
+// Inner loop of all pliers, starting at flat iterator p. When the strides are unit_stride, use those. The
+// static stride lets the compiler vectorize.
+template <class P, class S>
+inline constexpr void
+ply_flat(P p, dim_t s, S const & ss0)
+{
+    using U = unit_stride_t<P>;
+    if (is_unit_stride<U>(ss0)) {
+        for (; s>0; --s, p+=U {}) {
+            *p;
+        }
+    } else {
+        for (; s>0; --s, p+=ss0) {
+            *p;
+        }
+    }
+}
+
+template <class A, class S>
+inline constexpr void
+ply_inner(A & a, dim_t s, S const & ss0)
+{
+    ply_flat(a.flat(), s, ss0);
+}
+
+// Default inner loop of ply_ravel.
+struct ply_flat_t
+{
+    template <class P, class S> constexpr void operator()(P p, dim_t s, S const & ss0) const { ply_flat(p, s, ss0); }
+};
+
+// Type of the first leaf of flat iterator F, to choose ply_stack in ply_ravel. Specialized for Flat (expr.hh).
+template <class F>
+struct flat_first
+{
+    using type = F;
+};
+
+// Space for n objects, in place if n<=N, else on the heap.
+template <class T, int N>
+struct ply_buffer
+{
+    T a[N];
+    std::unique_ptr<T []> b;
+    T * p;
+
+    explicit ply_buffer(int n): b(n>N ? new T[n] : nullptr), p(n>N ? b.get() : a) {}
+    ply_buffer(ply_buffer const &) = delete;
+    ply_buffer & operator=(ply_buffer const &) = delete;
+    T & operator[](int k) { return p[k]; }
+};
+
+// Traverse with an explicit stack of flat iterators, as in Blitz++. Used by ply_ravel when the first leaf is a raw
+// pointer. ocd, sha, rank as in ply_ravel (the non-ravelled axes, innermost first). The position on each axis is
+// kept as a count of the steps left, so no iterator is moved past the end of its axis, whatever the strides.
+// Moving on an axis is a single addition, and the inner axes restart from a copy, so there's no rewind.
+template <class A, class S, class Inner>
+inline void
+ply_stack(A & a, rank_t rank, rank_t const * ocd, dim_t const * sha, dim_t ss, S const & ss0, Inner & inner)
+{
+    using F = decltype(a.flat());
+    using ST = decltype(a.stride(0));
+// not VLAs, since these types needn't be trivial. rank is known to fit if A has static rank.
+    constexpr int N = rank_s<A>()>0 ? int(rank_s<A>()) : 8;
+    ply_buffer<std::optional<F>, N> p(rank); // flat iterators needn't be assignable.
+    ply_buffer<ST, N> st(rank);
+    ply_buffer<dim_t, N> left(rank);
+    for (int k=0; k<rank; ++k) {
+        p[k].emplace(a.flat());
+        st[k] = a.stride(ocd[k]);
+        left[k] = sha[k];
+    }
+    for (;;) {
+        inner(*p[0], ss, ss0);
+        int k = 0;
+        while (--left[k]==0) {
+            if (++k>=rank) {
+                return;
+            }
+        }
+        *p[k] += st[k];
+        for (; k>0; --k) {
+            p[k-1].emplace(*p[k]);
+            left[k-1] = sha[k-1];
+        }
+    }
+}
+
+// Traversal order for a, innermost axis first. The weight of an axis is the sum of the strides of
+// all the leaves on that axis, and the axes with smaller weight go inside. Axes of size 1 go
+// outside, since their strides don't matter. Ties are broken in row-major order.
+template <class A>
+inline void
+ply_order(A const & a, rank_t * order)
+{
+    rank_t const rank = a.rank();
+    assert(rank>=0); // FIXME see test in [ra40].
+    constexpr int nleaves = stride_leaves<decltype(a.stride(0))>;
+    dim_t w[rank], st[nleaves];
+    for (rank_t k=0; k<rank; ++k) {
+        order[k] = rank-1-k;
+        if (a.size(k)==1) {
+            w[k] = std::numeric_limits<dim_t>::max();
+        } else {
+            stride_flatten(a.stride(k), st);
+            w[k] = 0;
+            for (int l=0; l<nleaves; ++l) {
+                w[k] += std::abs(st[l]);
+            }
+        }
+    }
+    std::stable_sort(order, order+rank, [&w](rank_t i, rank_t j) { return w[i]<w[j]; });
+}
+
 // Traverse array expression looking to ravel the inner loop.
 // size(k) has a single value.
-// adv(k), stride(k), keep_stride(st, k, l) and flat() are used on all the leaf arguments.
+// adv(k), stride(k), keep_stride(st, k, l) and flat() are used on all the leaf arguments, and jump(k) on those that
+// define it (see ra::jump).
 // The strides must give 0 for k>=their own rank, to allow frame matching.
-// TODO Traversal order should be a parameter, since some operations (e.g. output, ravel) require a specific order.
-template <RaIterator A>
+// The order of traversal is given by ply_order, unless reorder is false, in which case it's row-major.
+// Some operations (e.g. output, ravel) need the latter.
+// inner(p, s, ss0) runs the inner loop from flat iterator p, for s steps of ss0. See ply_flat, ReduceInner.
+template <RaIterator A, class Inner=ply_flat_t>
 inline void
-ply_ravel(A && a)
+ply_ravel(A && a, bool reorder=true, Inner && inner=Inner {})
 {
     rank_t rank = a.rank();
     assert(rank>=0); // FIXME see test in [ra40].
-    rank_t order[rank];
-    for (rank_t i=0; i<rank; ++i) {
-        order[i] = rank-1-i;
+    if (rank==0) {
+        inner(a.flat(), 1, a.stride(0));
+        return;
     }
-    switch (rank) {
-    case 0: *(a.flat()); return;
-    case 1: break;
-    default: // TODO find a decent heuristic
-        // if (rank>1) {
-        //     std::sort(order, order+rank, [&a, &order](auto && i, auto && j)
-        //               { return a.size(order[i])<a.size(order[j]); });
-        // }
-        ;
+// sha, ind are only needed for the axes that aren't ravelled, but a VLA of size 0 is UB.
+    rank_t order[rank];
+    dim_t sha[rank], ind[rank];
+    if (reorder && rank>1) {
+        ply_order(a, order);
+    } else {
+        for (rank_t i=0; i<rank; ++i) {
+            order[i] = rank-1-i;
+        }
     }
 // outermost compact dim.
     rank_t * ocd = order;
@@ -52,7 +226,6 @@ ply_ravel(A && a)
     for (--rank, ++ocd; rank>0 && a.keep_stride(ss, order[0], *ocd); --rank, ++ocd) {
         ss *= a.size(*ocd);
     }
-    dim_t sha[rank], ind[rank];
     for (int k=0; k<rank; ++k) {
         ind[k] = 0;
         sha[k] = a.size(ocd[k]);
@@ -63,12 +236,14 @@ ply_ravel(A && a)
     }
 // all sub xpr strides advance in compact dims, as they might be different.
     auto const ss0 = a.stride(order[0]);
-// TODO Blitz++ uses explicit stack of end-of-dim p positions, has special cases for common/unit stride.
-    for (;;) {
-        dim_t s = ss;
-        for (auto p=a.flat(); s>0; --s, p+=ss0) {
-            *p;
+    if constexpr (std::is_pointer_v<typename flat_first<decltype(a.flat())>::type>) {
+        if (rank>0) {
+            ply_stack(a, rank, ocd, sha, ss, ss0, inner);
+            return;
         }
+    }
+    for (;;) {
+        inner(a.flat(), ss, ss0);
         for (int k=0; ; ++k) {
             if (k>=rank) {
                 return;
@@ -84,6 +259,116 @@ ply_ravel(A && a)
     }
 }
 
+
+// ---------------------------
+// Tiled traversal.
+// ---------------------------
+
+// RaIterator A, with sizes restricted to sz[0...rank). Used to ply each of the tiles in ply_tiled.
+template <class A>
+struct Tile
+{
+    A a;
+    dim_t const * sz;
+
+    constexpr rank_t rank() const { return a.rank(); }
+    constexpr dim_t size(int k) const { return sz[k]; }
+    constexpr void adv(rank_t k, dim_t d) { a.adv(k, d); }
+    constexpr void jump(rank_t k, dim_t d) { ra::jump(a, k, d); }
+    constexpr auto stride(int k) const { return a.stride(k); }
+    constexpr bool keep_stride(dim_t st, int z, int j) const { return a.keep_stride(st, z, j); }
+    constexpr decltype(auto) flat() { return a.flat(); }
+};
+
+// Traverse a in tiles of about tile_size elements, each tile with ply_ravel.
+// The axes that are tiled are the fastest (smallest nonzero stride) axis of each of the leaves. The
+// other axes are traversed one by one outside the tiles. This helps e.g. with A = transpose<1, 0>(B).
+// If all the leaves agree on the last axis being fastest, this is the same as ply_ravel.
+template <RaIterator A>
+inline void
+ply_tiled(A && a, dim_t tile_size)
+{
+    rank_t const rank = a.rank();
+    assert(rank>=0); // FIXME see test in [ra40].
+    if (rank<2) {
+        ply_ravel(std::forward<A>(a));
+        return;
+    }
+    constexpr int nleaves = stride_leaves<decltype(a.stride(0))>;
+    rank_t fast[nleaves];
+    dim_t best[nleaves], st[nleaves];
+    for (int l=0; l<nleaves; ++l) {
+        fast[l] = rank-1;
+        best[l] = 0;
+    }
+    for (rank_t k=rank-1; k>=0; --k) {
+        stride_flatten(a.stride(k), st);
+        for (int l=0; l<nleaves; ++l) {
+            if (dim_t s=std::abs(st[l]); s!=0 && (best[l]==0 || s<best[l])) {
+                best[l] = s;
+                fast[l] = k;
+            }
+        }
+    }
+    dim_t sha[rank];
+    for (rank_t k=0; k<rank; ++k) {
+        sha[k] = a.size(k);
+        if (sha[k]==0) {
+            return;
+        }
+        RA_CHECK(sha[k]!=DIM_BAD, "undefined dim ", k);
+    }
+// Fast axes that fit in a tile aren't split. If fewer than two axes are left to split, there's no point.
+    bool isfast[rank], tiled[rank];
+    int ntiled = 0;
+    for (rank_t k=0; k<rank; ++k) {
+        isfast[k] = tiled[k] = std::any_of(fast, fast+nleaves, [&k](auto f) { return f==k; });
+        ntiled += tiled[k];
+    }
+    dim_t b = 0;
+    for (bool again=true; again && ntiled>=2; ) {
+        again = false;
+        b = std::max(dim_t(2), dim_t(std::pow(double(tile_size), 1./ntiled)));
+        for (rank_t k=0; k<rank; ++k) {
+            if (tiled[k] && sha[k]<=b) {
+                tiled[k] = false;
+                --ntiled;
+                tile_size = std::max(dim_t(1), tile_size/sha[k]);
+                again = true;
+            }
+        }
+    }
+    if (ntiled<2) {
+        ply_ravel(std::forward<A>(a));
+        return;
+    }
+// bs: size of the tiles on each axis; ind: start of the current tile; sz: size of the current tile.
+    dim_t bs[rank], ind[rank], sz[rank];
+    for (rank_t k=0; k<rank; ++k) {
+        bs[k] = tiled[k] ? b : isfast[k] ? sha[k] : 1;
+        ind[k] = 0;
+        sz[k] = std::min(bs[k], sha[k]);
+    }
+// ply_ravel leaves a where it found it, so we only need to move between tiles.
+    for (;;) {
+        ply_ravel(Tile<std::decay_t<A> &> { a, sz });
+        for (rank_t k=rank-1; ; --k) {
+            if (k<0) {
+                return;
+            } else if (ind[k]+bs[k]<sha[k]) {
+                ind[k] += bs[k];
+                sz[k] = std::min(bs[k], sha[k]-ind[k]);
+                jump(a, k, bs[k]);
+                break;
+            } else {
+                jump(a, k, -ind[k]);
+                ind[k] = 0;
+                sz[k] = std::min(bs[k], sha[k]);
+            }
+        }
+    }
+}
+
 
 // -------------------------
 // Compile time order.
@@ -94,14 +379,21 @@ ply_ravel(A && a)
 #endif
 #define RA_INLINE inline /* __attribute__((always_inline)) inline */
 
-template <class order, int ravel_rank, class A, class S>
+// Fully unrolled inner loop, for static s. Used by plyf when the compact dims are known at compile time.
+template <class A, int s, class S>
+RA_INLINE constexpr void
+ply_inner(A & a, mp::int_t<s>, S const & ss0)
+{
+    auto p = a.flat();
+    [&]<int ... i>(mp::int_list<i ...>) { ((void(i), *p, p+=ss0), ...); }(mp::iota<s> {});
+}
+
+template <class order, int ravel_rank, class A, class N, class S>
 RA_INLINE constexpr void
-subindex(A & a, dim_t s, S const & ss0)
+subindex(A & a, N s, S const & ss0)
 {
     if constexpr (mp::len<order> == ravel_rank) {
-        for (auto p=a.flat(); s>0; --s, p+=ss0) {
-            *p;
-        }
+        ply_inner(a, s, ss0);
     } else if constexpr (mp::len<order> > ravel_rank) {
         dim_t size = a.size(mp::first<order>::value); // TODO Precompute these at the top
         for (dim_t i=0, iend=size; i<iend; ++i) {
@@ -114,39 +406,25 @@ subindex(A & a, dim_t s, S const & ss0)
     }
 }
 
-// until() converts runtime jj into compile time j. TODO a.adv<k>().
-template <class order, int j, class A, class S>
-RA_INLINE constexpr void
-until(int const jj, A & a, dim_t const s, S const & ss0)
-{
-    if constexpr (mp::len<order> < j) {
-        assert(0 && "rank too high");
-    } else if constexpr (mp::len<order> >= j) {
-        if (jj==j) {
-            subindex<order, j>(a, s, ss0);
-        } else {
-            until<order, j+1>(jj, a, s, ss0);
-        }
-    } else {
-        abort();
-    }
-}
-
-// find the outermost compact dim.
+// find the outermost compact dim, from the type alone.
 template <class A>
 constexpr auto
-ocd(A && a)
+ocd()
 {
-    rank_t const rank = a.rank();
-    auto s = a.size(rank-1);
+    using AA = std::decay_t<A>;
+    constexpr rank_t rank = AA::rank_s();
+    dim_t s = AA::size_s(rank-1);
     int j = 1;
-    while (j<rank && a.keep_stride(s, rank-1, rank-1-j)) {
-        s *= a.size(rank-1-j);
+    while (j<rank && AA::keep_stride(s, rank-1, rank-1-j)) {
+        s *= AA::size_s(rank-1-j);
         ++j;
     }
     return std::make_tuple(s, j);
 };
 
+// largest compact block that plyf unrolls completely.
+constexpr dim_t plyf_unroll_max = 64;
+
 template <RaIterator A>
 RA_INLINE constexpr void
 plyf(A && a)
@@ -156,20 +434,20 @@ plyf(A && a)
 
     if constexpr (rank_s<A>()==0) {
         *(a.flat());
-    } else if constexpr (rank_s<A>()==1) {
-        subindex<mp::iota<1>, 1>(a, a.size(0), a.stride(0));
-    } else if constexpr (0 && size_s<A>()>=0) {
-// this can only be enabled when f() will be constexpr; size_s isn't enough b/c of keep_stride.
-// test/concrete.cc has a case that shows this.
-// cf https://stackoverflow.com/questions/55288555
-        constexpr auto sj = ocd(a);
+    } else if constexpr (size_s<A>()>=0 && StaticKeepStride<A>) {
+// all sub xpr strides advance in compact dims, as they might be different.
+        constexpr auto sj = ocd<A>();
         constexpr auto s = std::get<0>(sj);
         constexpr auto j = std::get<1>(sj);
-// all sub xpr strides advance in compact dims, as they might be different.
-// send with static j. Note that order here is inverse of order.
-        until<mp::iota<rank_s<A>()>, 0>(j, a, s, a.stride(rank-1));
+        if constexpr (s<=plyf_unroll_max) {
+            subindex<mp::iota<rank>, j>(a, mp::int_t<int(s)> {}, a.stride(rank-1));
+        } else {
+            subindex<mp::iota<rank>, j>(a, s, a.stride(rank-1));
+        }
+    } else if constexpr (rank_s<A>()==1) {
+        subindex<mp::iota<1>, 1>(a, a.size(0), a.stride(0));
     } else {
-// the unrolling above isn't worth it when s, j cannot be constexpr.
+// the unrolling above isn't possible when s, j cannot be constexpr.
         auto s = a.size(rank-1);
         subindex<mp::iota<rank_s<A>()>, 1>(a, s, a.stride(rank-1));
     }
@@ -195,35 +473,361 @@ ply(A && a)
 
 
 // ---------------------------
-// Short-circuiting pliers.
+// Parallel traversal.
 // ---------------------------
 
-// TODO Refactor with ply_ravel. Make exit available to plyf.
-// TODO These are reductions. How to do higher rank?
-template <RaIterator A, class DEF>
-inline auto
-ply_ravel_exit(A && a, DEF && def)
+// Traversal policies for ply, for_each. par(n) splits the work in n chunks, or in as many as the pool has threads
+// if n<=0. The chunks run on the pool given by par(pool), or else on ThreadPool::current_pool() (see pool.hh).
+// tiled(n) uses tiles of about n elements (see ply_tiled). ordered traverses in row-major order.
+struct seq_t {};
+struct ordered_t {};
+struct par_t
+{
+    int nthreads = 0;
+    ThreadPool * pool_ = nullptr;
+    constexpr par_t operator()(int n) const { return par_t { n, pool_ }; }
+    constexpr par_t operator()(ThreadPool & p) const { return par_t { nthreads, &p }; }
+    constexpr par_t operator()(ThreadPool & p, int n) const { return par_t { n, &p }; }
+    ThreadPool & pool() const { return pool_ ? *pool_ : ThreadPool::current_pool(); }
+    int threads() const { return nthreads>0 ? nthreads : pool().size(); }
+};
+struct tiled_t
+{
+    dim_t tile_size = 4096;
+    constexpr tiled_t operator()(dim_t n) const { return tiled_t { n }; }
+};
+constexpr seq_t seq {};
+constexpr ordered_t ordered {};
+constexpr par_t par {};
+constexpr tiled_t tiled {};
+
+RA_IS_DEF(is_policy, (std::is_same_v<A, seq_t> || std::is_same_v<A, ordered_t> || std::is_same_v<A, par_t>
+                      || std::is_same_v<A, tiled_t>))
+
+// Start of chunk t of [0 n) split in m chunks.
+constexpr dim_t
+par_split(dim_t n, int m, int t)
+{
+    return n*t/m;
+}
+
+// RaIterator A, with axis ax restricted to [0 n). Used to ply each of the chunks in ply_par.
+template <class A>
+struct Slab
+{
+    A a;
+    rank_t ax;
+    dim_t n;
+
+    constexpr rank_t rank() const { return a.rank(); }
+    constexpr dim_t size(int k) const { return k==ax ? n : a.size(k); }
+    constexpr void adv(rank_t k, dim_t d) { a.adv(k, d); }
+    constexpr void jump(rank_t k, dim_t d) { ra::jump(a, k, d); }
+    constexpr auto stride(int k) const { return a.stride(k); }
+    constexpr bool keep_stride(dim_t st, int z, int j) const { return a.keep_stride(st, z, j); }
+    constexpr decltype(auto) flat() { return a.flat(); }
+};
+
+// Axis to split in ply_par: the outermost axis in the order of ply_order on which the first leaf has nonzero stride,
+// so that no two chunks reach the same element of the first leaf. -1 if there is no such axis of size >1.
+template <class A>
+inline rank_t
+par_axis(A const & a, rank_t const * order, rank_t rank)
+{
+    for (rank_t k=rank-1; k>=0; --k) {
+        dim_t const n = a.size(order[k]);
+        RA_CHECK(n!=DIM_BAD, "undefined dim ", order[k]);
+        if (n>1 && stride_first(a.stride(order[k]))!=0) {
+            return order[k];
+        }
+    }
+    return -1;
+}
+
+// Split an outer axis (see par_axis) in chunks, and ply each one of them with ply_ravel on the pool of policy. Each
+// chunk is a copy of a, advanced to the start of the chunk. Exceptions are propagated to the caller. The chunks are
+// pinned to the threads of the pool (see ThreadPool::run), so each chunk of the same array goes to the same thread
+// from call to call.
+// FIXME iterators that are held by reference in a (see [ra35]) are shared among the threads.
+template <RaIterator A>
+inline void
+ply_par(A && a, par_t const & policy)
 {
     rank_t rank = a.rank();
     assert(rank>=0); // FIXME see test in [ra40].
+    if (rank==0) {
+        *(a.flat());
+        return;
+    }
     rank_t order[rank];
-    for (rank_t i=0; i<rank; ++i) {
-        order[i] = rank-1-i;
+    ply_order(a, order);
+    rank_t const ax = par_axis(a, order, rank);
+    dim_t const n = ax>=0 ? a.size(ax) : 1;
+    int const m = int(std::min(dim_t(policy.threads()), n));
+    if (m<2) {
+        ply_ravel(std::forward<A>(a));
+        return;
+    }
+    policy.pool().run(m, [&](int t)
+                          {
+                              std::decay_t<A> c = a;
+                              dim_t b = par_split(n, m, t);
+                              jump(c, ax, b);
+                              ply_ravel(Slab<std::decay_t<A> &> { c, ax, par_split(n, m, t+1)-b });
+                          }, true);
+}
+
+template <RaIterator A>
+inline constexpr void
+ply(seq_t, A && a)
+{
+    ply(std::forward<A>(a));
+}
+
+template <RaIterator A>
+inline constexpr void
+ply(ordered_t, A && a)
+{
+    if constexpr (size_s<A>()==DIM_ANY) {
+        ply_ravel(std::forward<A>(a), false);
+    } else {
+        plyf(std::forward<A>(a));
+    }
+}
+
+// Static size expressions aren't worth splitting.
+template <RaIterator A>
+inline void
+ply(par_t const & policy, A && a)
+{
+    if constexpr (size_s<A>()==DIM_ANY) {
+        ply_par(std::forward<A>(a), policy);
+    } else {
+        plyf(std::forward<A>(a));
+    }
+}
+
+
+template <RaIterator A>
+inline void
+ply(tiled_t const & policy, A && a)
+{
+    if constexpr (size_s<A>()==DIM_ANY) {
+        ply_tiled(std::forward<A>(a), policy.tile_size);
+    } else {
+        plyf(std::forward<A>(a));
+    }
+}
+
+
+// ---------------------------
+// Reductions.
+// ---------------------------
+
+// Reduction with identity element id and combine op(c, x). op must be associative and commutative, since the
+// elements are visited in any order and in several pieces, which are then combined with op.
+template <class T, class Op>
+struct Reduction
+{
+    T id;
+    Op op;
+};
+
+template <class T, class Op>
+constexpr Reduction<T, Op>
+reduction(T id, Op op)
+{
+    return Reduction<T, Op> { id, op };
+}
+
+// Combine c(i) ... c(i+n-1) pairwise, always in the same way for the same n.
+template <class Op, class C>
+constexpr auto
+reduce_tree(Op const & op, int i, int n, C const & c)
+{
+    if (n==1) {
+        return c(i);
+    } else {
+        int h = n/2;
+        return op(reduce_tree(op, i, h, c), reduce_tree(op, i+h, n-h, c));
+    }
+}
+
+// Number of independent accumulators in ReduceInner, so the combines don't form a single dependency chain.
+constexpr int reduce_lanes = 4;
+
+// Inner loop for ply_ravel that accumulates into reduce_lanes accumulators in turn.
+template <class T, class Op>
+struct ReduceInner
+{
+    Op const & op;
+    T c[reduce_lanes];
+
+    ReduceInner(Op const & op_, T const & id): op(op_) { std::fill(c, c+reduce_lanes, id); }
+
+    template <class P, class S>
+    void operator()(P p, dim_t s, S const & ss0)
+    {
+        using U = unit_stride_t<P>;
+        if (is_unit_stride<U>(ss0)) {
+            run(p, s, U {});
+        } else {
+            run(p, s, ss0);
+        }
+    }
+    template <class P, class S>
+    void run(P & p, dim_t s, S const & ss0)
+    {
+        for (; s>=reduce_lanes; s-=reduce_lanes) {
+            [&]<int ... l>(mp::int_list<l ...>) { ((c[l] = op(c[l], *p), p+=ss0), ...); }(mp::iota<reduce_lanes> {});
+        }
+        for (; s>0; --s, p+=ss0) {
+            c[0] = op(c[0], *p);
+        }
+    }
+    T result() const { return reduce_tree(op, 0, reduce_lanes, [this](int l) { return c[l]; }); }
+};
+
+template <RaIterator A, class T, class Op>
+inline T
+ply_reduce(A && a, Reduction<T, Op> const & red)
+{
+    ReduceInner<T, Op> inner(red.op, red.id);
+    ply_ravel(std::forward<A>(a), true, inner);
+    return inner.result();
+}
+
+// Reduction for sum_pairwise. See PairwiseInner.
+template <class T>
+struct PairwiseSum
+{
+    T id {};
+    struct { constexpr T operator()(T const & a, T const & b) const { return a+b; } } op;
+};
+
+// Pairwise summation, for ply_ravel. Each run of the inner loop is summed by halves, down to blocks of pairwise_block
+// elements that are summed in a plain loop. The sums of the runs go into a binary counter, where level[k] holds the
+// sum of 2^k runs, so runs are also summed pairwise. The error grows as log(n) and not as n.
+constexpr dim_t pairwise_block = 64;
+
+template <class T>
+struct PairwiseInner
+{
+    T level[64];
+    std::uint64_t count = 0;
+
+    template <class P, class S>
+    void operator()(P p, dim_t s, S const & ss0)
+    {
+        using U = unit_stride_t<P>;
+        T x = is_unit_stride<U>(ss0) ? run(p, s, U {}) : run(p, s, ss0);
+        int k = 0;
+        for (std::uint64_t c=count; c&1; c>>=1, ++k) {
+            x = level[k]+x;
+        }
+        level[k] = x;
+        ++count;
+    }
+    template <class P, class S>
+    T run(P & p, dim_t s, S const & ss0)
+    {
+        if (s<=pairwise_block) {
+            T x {};
+            for (; s>0; --s, p+=ss0) {
+                x += *p;
+            }
+            return x;
+        } else {
+            T x = run(p, s/2, ss0);
+            return x + run(p, s-s/2, ss0);
+        }
+    }
+    T result() const
+    {
+        T x {};
+        for (int k=0; k<64; ++k) {
+            if ((count>>k) & 1) {
+                x = level[k]+x;
+            }
+        }
+        return x;
     }
-    switch (rank) {
-    case 0: {
+};
+
+template <RaIterator A, class T>
+inline T
+ply_reduce(A && a, PairwiseSum<T> const & red)
+{
+    PairwiseInner<T> inner;
+    ply_ravel(std::forward<A>(a), true, inner);
+    return inner.result();
+}
+
+// Like ply_par, with a partial result for each chunk. The partials are combined with reduce_tree, so for a given
+// number of threads the result doesn't depend on the timing of the threads.
+template <RaIterator A, class Red>
+inline decltype(Red::id)
+ply_par_reduce(A && a, Red const & red, par_t const & policy)
+{
+    using T = decltype(Red::id);
+    rank_t rank = a.rank();
+    assert(rank>=0); // FIXME see test in [ra40].
+    if (rank==0) {
+        return ply_reduce(std::forward<A>(a), red);
+    }
+    rank_t order[rank];
+    ply_order(a, order);
+    rank_t const ax = order[rank-1];
+    dim_t const n = a.size(ax);
+    RA_CHECK(n!=DIM_BAD, "undefined dim ", ax);
+    int const m = int(std::min(dim_t(policy.threads()), n));
+    if (m<2) {
+        return ply_reduce(std::forward<A>(a), red);
+    }
+    std::vector<std::optional<T>> part(m);
+    policy.pool().run(m, [&](int t)
+                          {
+                              std::decay_t<A> c = a;
+                              dim_t b = par_split(n, m, t);
+                              jump(c, ax, b);
+                              part[t].emplace(ply_reduce(Slab<std::decay_t<A> &> { c, ax, par_split(n, m, t+1)-b }, red));
+                          }, true);
+    return reduce_tree(red.op, 0, m, [&part](int t) { return *part[t]; });
+}
+
+
+
+// ---------------------------
+// Short-circuiting pliers.
+// ---------------------------
+
+// Result of the short-circuiting pliers, from the tuple<bool, T> that the expression returns.
+template <class A> using exit_t = std::decay_t<decltype(std::get<1>(*(std::declval<A &>().flat())))>;
+
+struct never_stop { constexpr bool operator()() const { return false; } };
+
+// Traverse a in row-major order until the expression returns true in its first element. Then put the second element
+// in r and return true. If stop() returns true (it's checked after each inner loop), give up and return false.
+// TODO Refactor with ply_ravel.
+// TODO These are reductions. How to do higher rank?
+template <RaIterator A, class T, class STOP>
+inline bool
+ply_ravel_exit_(A && a, T & r, STOP const & stop)
+{
+    rank_t rank = a.rank();
+    assert(rank>=0); // FIXME see test in [ra40].
+    if (rank==0) {
         if (auto what = *(a.flat()); std::get<0>(what)) {
-            return std::get<1>(what);
+            r = std::get<1>(what);
+            return true;
         }
-        return def;
+        return false;
     }
-    case 1: break;
-    default: // TODO find a decent heuristic
-        // if (rank>1) {
-        //     std::sort(order, order+rank, [&a, &order](auto && i, auto && j)
-        //               { return a.size(order[i])<a.size(order[j]); });
-        // }
-        ;
+// Always row-major, so that early() finds the first hit. See ply_ravel for sha, ind.
+    rank_t order[rank];
+    dim_t sha[rank], ind[rank];
+    for (rank_t i=0; i<rank; ++i) {
+        order[i] = rank-1-i;
     }
 // outermost compact dim.
     rank_t * ocd = order;
@@ -231,28 +835,30 @@ ply_ravel_exit(A && a, DEF && def)
     for (--rank, ++ocd; rank>0 && a.keep_stride(ss, order[0], *ocd); --rank, ++ocd) {
         ss *= a.size(*ocd);
     }
-    dim_t sha[rank], ind[rank];
     for (int k=0; k<rank; ++k) {
         ind[k] = 0;
         sha[k] = a.size(ocd[k]);
         if (sha[k]==0) { // for the ravelled dimensions ss takes care.
-            return def;
+            return false;
         }
         RA_CHECK(sha[k]!=DIM_BAD, "undefined dim ", ocd[k]);
     }
 // all sub xpr strides advance in compact dims, as they might be different.
     auto const ss0 = a.stride(order[0]);
-// TODO Blitz++ uses explicit stack of end-of-dim p positions, has special cases for common/unit stride.
     for (;;) {
         dim_t s = ss;
         for (auto p=a.flat(); s>0; --s, p+=ss0) {
             if (auto what = *p; std::get<0>(what)) {
-                return std::get<1>(what);
+                r = std::get<1>(what);
+                return true;
             }
         }
+        if (stop()) {
+            return false;
+        }
         for (int k=0; ; ++k) {
             if (k>=rank) {
-                return def;
+                return false;
             } else if (ind[k]<sha[k]-1) {
                 ++ind[k];
                 a.adv(ocd[k], 1);
@@ -265,11 +871,147 @@ ply_ravel_exit(A && a, DEF && def)
     }
 }
 
+template <RaIterator A, class DEF>
+inline auto
+ply_ravel_exit(A && a, DEF && def)
+{
+    exit_t<A> r = std::forward<DEF>(def);
+    ply_ravel_exit_(std::forward<A>(a), r, never_stop {});
+    return r;
+}
+
+// Inner loop of plyf_exit. Unrolled when s is static, as in plyf.
+template <class A, class S, class T>
+inline constexpr bool
+ply_inner_exit(A & a, dim_t s, S const & ss0, T & r)
+{
+    for (auto p=a.flat(); s>0; --s, p+=ss0) {
+        if (auto what = *p; std::get<0>(what)) {
+            r = std::get<1>(what);
+            return true;
+        }
+    }
+    return false;
+}
+
+template <class A, int s, class S, class T>
+inline constexpr bool
+ply_inner_exit(A & a, mp::int_t<s>, S const & ss0, T & r)
+{
+    auto p = a.flat();
+    auto hit = [&]()
+               {
+                   if (auto what = *p; std::get<0>(what)) {
+                       r = std::get<1>(what);
+                       return true;
+                   }
+                   p += ss0;
+                   return false;
+               };
+    return [&]<int ... i>(mp::int_list<i ...>) { return ((void(i), hit()) || ...); }(mp::iota<s> {});
+}
+
+// Like subindex, but stop at the first hit. a isn't restored in that case.
+template <class order, int ravel_rank, class A, class N, class S, class T>
+inline constexpr bool
+subindex_exit(A & a, N s, S const & ss0, T & r)
+{
+    if constexpr (mp::len<order> == ravel_rank) {
+        return ply_inner_exit(a, s, ss0, r);
+    } else {
+        dim_t size = a.size(mp::first<order>::value);
+        for (dim_t i=0; i<size; ++i) {
+            if (subindex_exit<mp::drop1<order>, ravel_rank>(a, s, ss0, r)) {
+                return true;
+            }
+            a.adv(mp::first<order>::value, 1);
+        }
+        a.adv(mp::first<order>::value, -size);
+        return false;
+    }
+}
+
+// Short-circuiting plyf. Row-major, so the first hit is found, as in ply_ravel_exit.
+template <RaIterator A, class DEF>
+inline constexpr auto
+plyf_exit(A && a, DEF && def)
+{
+    constexpr rank_t rank = rank_s<A>();
+    static_assert(rank>=0, "plyf_exit needs static rank");
+
+    exit_t<A> r = std::forward<DEF>(def);
+    if constexpr (rank==0) {
+        if (auto what = *(a.flat()); std::get<0>(what)) {
+            r = std::get<1>(what);
+        }
+    } else if constexpr (size_s<A>()>=0 && StaticKeepStride<A>) {
+        constexpr auto sj = ocd<A>();
+        constexpr auto s = std::get<0>(sj);
+        constexpr auto j = std::get<1>(sj);
+        if constexpr (s<=plyf_unroll_max) {
+            subindex_exit<mp::iota<rank>, j>(a, mp::int_t<int(s)> {}, a.stride(rank-1), r);
+        } else {
+            subindex_exit<mp::iota<rank>, j>(a, s, a.stride(rank-1), r);
+        }
+    } else {
+        subindex_exit<mp::iota<rank>, 1>(a, a.size(rank-1), a.stride(rank-1), r);
+    }
+    return r;
+}
+
+// Split axis 0 in chunks and run each one with ply_ravel_exit on the pool of policy. The result is that of the first
+// chunk with a hit, so it's the same as with ply_ravel_exit. A chunk gives up as soon as an earlier chunk has a hit.
+template <RaIterator A, class DEF>
+inline auto
+ply_par_exit(A && a, DEF && def, par_t const & policy)
+{
+    rank_t rank = a.rank();
+    assert(rank>=0); // FIXME see test in [ra40].
+    dim_t const n = rank>0 ? a.size(0) : 1;
+    RA_CHECK(n!=DIM_BAD, "undefined dim ", 0);
+    int const m = int(std::min(dim_t(policy.threads()), n));
+    if (m<2) {
+        return ply_ravel_exit(std::forward<A>(a), std::forward<DEF>(def));
+    }
+    using T = exit_t<A>;
+    std::vector<std::optional<T>> r(m); // not vector<T>, which could be vector<bool>.
+    std::atomic<int> first = m;
+    policy.pool().run(m, [&](int t)
+                          {
+                              std::decay_t<A> c = a;
+                              dim_t b = par_split(n, m, t);
+                              jump(c, 0, b);
+                              r[t].emplace(def);
+                              if (ply_ravel_exit_(Slab<std::decay_t<A> &> { c, 0, par_split(n, m, t+1)-b }, *r[t],
+                                                  [&first, t]() { return first.load(std::memory_order_relaxed)<t; })) {
+                                  for (int f=first.load(); t<f && !first.compare_exchange_weak(f, t); ) {}
+                              }
+                          }, true);
+    return first<m ? *r[first] : T(std::forward<DEF>(def));
+}
+
 template <RaIterator A, class DEF>
 inline decltype(auto)
 early(A && a, DEF && def)
 {
-    return ply_ravel_exit(std::forward<A>(a), std::forward<DEF>(def));
+    if constexpr (size_s<A>()==DIM_ANY) {
+        return ply_ravel_exit(std::forward<A>(a), std::forward<DEF>(def));
+    } else {
+        return plyf_exit(std::forward<A>(a), std::forward<DEF>(def));
+    }
+}
+
+// Only par changes early(). Static size expressions aren't worth splitting.
+template <class Policy, RaIterator A, class DEF>
+requires (is_policy<Policy>)
+inline decltype(auto)
+early(Policy const & policy, A && a, DEF && def)
+{
+    if constexpr (std::is_same_v<Policy, par_t> && size_s<A>()==DIM_ANY) {
+        return ply_par_exit(std::forward<A>(a), std::forward<DEF>(def), policy);
+    } else {
+        return early(std::forward<A>(a), std::forward<DEF>(def));
+    }
 }
 
 } // namespace ra
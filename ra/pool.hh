@@ -0,0 +1,317 @@
+// -*- mode: c++; coding: utf-8 -*-
+/// @file pool.hh
+/// @brief Work-stealing thread pool for the parallel traversal policies.
+
+// This library is free software; you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option) any
+// later version.
+
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <algorithm>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace ra {
+
+// A ThreadPool of size n runs up to n tasks at once, on n-1 worker threads and on the thread that calls run().
+// Each worker has its own queue. It takes tasks from the back of its own queue and steals them from the front of
+// the others' queues when its own is empty.
+// A thread that waits in run() keeps running tasks from the queues, so nested calls to run() (e.g. a parallel
+// for_each whose op calls a parallel sum) go to the same workers and never start more threads.
+// Each worker also has a queue of pinned tasks, which only it runs. See run() with pinned.
+class ThreadPool
+{
+    struct Job
+    {
+        void (*call)(void *, int);
+        void * chunk;
+        std::atomic<int> pending;
+        std::exception_ptr error;
+        std::mutex error_mutex;
+
+        Job(void (*call_)(void *, int), void * chunk_, int m): call(call_), chunk(chunk_), pending(m) {}
+        void run(int t)
+        {
+            try {
+                call(chunk, t);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+            pending.fetch_sub(1, std::memory_order_release);
+        }
+    };
+    struct Task { Job * job; int t; };
+    struct Queue { std::mutex m; std::deque<Task> q, pinned; std::atomic<int> npinned = 0; };
+
+    std::vector<std::thread> workers;
+    std::unique_ptr<Queue []> queues;
+    int nqueues;
+    std::atomic<int> queued = 0;
+    std::atomic<unsigned> next = 0;
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+    bool done = false;
+
+// The pool and the queue of the worker thread, if this is one.
+    static inline thread_local ThreadPool * current = nullptr;
+    static inline thread_local int current_queue = -1;
+
+    void push(int w, Task k)
+    {
+        {
+            std::lock_guard<std::mutex> lock(queues[w].m);
+            queues[w].q.push_back(k);
+        }
+        queued.fetch_add(1);
+    }
+    void push_pinned(int w, Task k)
+    {
+        std::lock_guard<std::mutex> lock(queues[w].m);
+        queues[w].pinned.push_back(k);
+        queues[w].npinned.fetch_add(1);
+    }
+    bool pop_pinned(int w, Task & k)
+    {
+        if (w>=0 && queues[w].npinned.load()>0) {
+            std::lock_guard<std::mutex> lock(queues[w].m);
+            k = queues[w].pinned.front();
+            queues[w].pinned.pop_front();
+            queues[w].npinned.fetch_sub(1);
+            return true;
+        }
+        return false;
+    }
+    bool pop(int w, Task & k)
+    {
+        if (w>=0) {
+            std::lock_guard<std::mutex> lock(queues[w].m);
+            if (!queues[w].q.empty()) {
+                k = queues[w].q.back();
+                queues[w].q.pop_back();
+                queued.fetch_sub(1);
+                return true;
+            }
+        }
+        for (int i=1; i<=nqueues; ++i) {
+            int v = (std::max(w, 0)+i) % nqueues;
+            std::lock_guard<std::mutex> lock(queues[v].m);
+            if (!queues[v].q.empty()) {
+                k = queues[v].q.front();
+                queues[v].q.pop_front();
+                queued.fetch_sub(1);
+                return true;
+            }
+        }
+        return false;
+    }
+// Run tasks from the queues until job is done.
+    void help(Job & job, int w)
+    {
+        for (Task k; job.pending.load(std::memory_order_acquire)>0; ) {
+            if (pop_pinned(w, k) || pop(w, k)) {
+                k.job->run(k.t);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+    void work(int w)
+    {
+        current = this;
+        current_queue = w;
+        for (Task k;;) {
+            if (pop_pinned(w, k) || pop(w, k)) {
+                k.job->run(k.t);
+            } else {
+                std::unique_lock<std::mutex> lock(sleep_mutex);
+                wake.wait(lock, [this, w] { return done || queued.load()>0 || queues[w].npinned.load()>0; });
+                if (done && queued.load()==0 && queues[w].npinned.load()==0) {
+                    return;
+                }
+            }
+        }
+    }
+
+public:
+// cpus[i % cpus.size()] is the CPU for worker i. This is only supported on Linux and ignored elsewhere.
+    explicit ThreadPool(int n, std::vector<int> const & cpus = {})
+        : nqueues(std::max(1, n-1))
+    {
+        queues.reset(new Queue[nqueues]);
+        workers.reserve(std::max(0, n-1));
+        for (int w=0; w<n-1; ++w) {
+            workers.emplace_back([this, w] { work(w); });
+#if defined(__linux__)
+            if (!cpus.empty()) {
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                CPU_SET(cpus[w % cpus.size()], &set);
+                pthread_setaffinity_np(workers.back().native_handle(), sizeof(set), &set);
+            }
+#endif
+        }
+    }
+    ThreadPool(ThreadPool const &) = delete;
+    ThreadPool & operator=(ThreadPool const &) = delete;
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            done = true;
+        }
+        wake.notify_all();
+        for (auto & w: workers) {
+            w.join();
+        }
+    }
+
+    int size() const { return int(workers.size())+1; }
+
+// Run chunk(t) for t in [0 m) and return when all are done. The first exception thrown by any chunk is rethrown to
+// the caller after all the chunks have finished.
+// With pinned, chunk t runs on the calling thread if t % size() is 0, and otherwise on worker t % size() - 1, and
+// it isn't stolen. So calls with the same m from the same thread map chunks to threads the same way, which is what
+// first_touch() relies on (see big.hh). Nested calls (from a task of this pool) ignore pinned, since the workers are
+// busy with the outer chunks.
+    template <class Chunk>
+    void run(int m, Chunk && chunk, bool pinned=false)
+    {
+        using C = std::remove_reference_t<Chunk>;
+        Job job([](void * c, int t) { (*static_cast<C *>(c))(t); }, (void *)(&chunk), m);
+        int const w = (current==this) ? current_queue : -1;
+// nested calls from the chunks that run on this thread go to this pool, too.
+        ThreadPool * const current0 = current;
+        int const queue0 = current_queue;
+        current = this;
+        current_queue = w;
+        if (pinned && current0!=this) {
+            for (int t=0; t<m; ++t) {
+                if (int const s = t % size(); s>0) {
+                    push_pinned(s-1, Task { &job, t });
+                }
+            }
+            { std::lock_guard<std::mutex> lock(sleep_mutex); }
+            wake.notify_all();
+            for (int t=0; t<m; t+=size()) {
+                job.run(t);
+            }
+        } else {
+            if (m>1) {
+                unsigned n0 = next.fetch_add(m-1);
+                for (int t=m-1; t>=1; --t) {
+                    push(w>=0 ? w : int((n0+t) % nqueues), Task { &job, t });
+                }
+                { std::lock_guard<std::mutex> lock(sleep_mutex); }
+                wake.notify_all();
+            }
+            job.run(0);
+        }
+        help(job, w);
+        current = current0;
+        current_queue = queue0;
+        if (job.error) {
+            std::rethrow_exception(job.error);
+        }
+    }
+
+// Task started with async(). wait() returns when the task is done, and runs queued tasks in the meantime, so the
+// task is run even if the pool has no worker threads. An exception thrown by the task is rethrown by wait(). If the
+// handle is destroyed or assigned to before wait(), it waits for the task, and the exception is lost.
+    class Async
+    {
+        friend class ThreadPool;
+        struct State
+        {
+            std::function<void()> f;
+            Job job;
+            explicit State(std::function<void()> f_)
+                : f(std::move(f_)), job([](void * s, int) { static_cast<State *>(s)->f(); }, this, 1) {}
+        };
+        ThreadPool * pool = nullptr;
+        std::unique_ptr<State> state;
+
+        void finish()
+        {
+            if (state) {
+                ThreadPool * const current0 = current;
+                int const queue0 = current_queue;
+                int const w = (current==pool) ? current_queue : -1;
+                current = pool;
+                current_queue = w;
+                pool->help(state->job, w);
+                current = current0;
+                current_queue = queue0;
+            }
+        }
+
+    public:
+        Async() = default;
+        Async(Async &&) = default;
+        Async & operator=(Async && a)
+        {
+            finish();
+            pool = a.pool;
+            state = std::move(a.state);
+            return *this;
+        }
+        ~Async() { finish(); }
+
+        bool valid() const { return bool(state); }
+        void wait()
+        {
+            finish();
+            std::unique_ptr<State> s = std::move(state);
+            if (s && s->job.error) {
+                std::rethrow_exception(s->job.error);
+            }
+        }
+    };
+
+// Queue f() to run on the pool, and return without waiting for it.
+    template <class F>
+    Async async(F && f)
+    {
+        Async a;
+        a.pool = this;
+        a.state = std::make_unique<Async::State>(std::forward<F>(f));
+        int const w = (current==this) ? current_queue : -1;
+        push(w>=0 ? w : int(next.fetch_add(1) % nqueues), Task { &(a.state->job), 0 });
+        { std::lock_guard<std::mutex> lock(sleep_mutex); }
+        wake.notify_one();
+        return a;
+    }
+
+// The pool that the calling thread works for, or else default_pool().
+    static ThreadPool & current_pool();
+};
+
+// Pool of size std::thread::hardware_concurrency(), made on first use.
+inline ThreadPool &
+default_pool()
+{
+    static ThreadPool pool(std::max(1, int(std::thread::hardware_concurrency())));
+    return pool;
+}
+
+inline ThreadPool &
+ThreadPool::current_pool()
+{
+    return current ? *current : default_pool();
+}
+
+} // namespace ra
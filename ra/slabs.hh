@@ -0,0 +1,162 @@
+// -*- mode: c++; coding: utf-8 -*-
+/// @file slabs.hh
+/// @brief Read and write arrays in the binary format of binary.hh, a slab at a time.
+
+// This library is free software; you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option) any
+// later version.
+
+// The slabs are blocks of up to a fixed number of rows along axis 0. Each slab is a View on one of two buffers, and
+// the other buffer is read or written in the meantime by a task on a ThreadPool, so only two slabs are ever in memory.
+
+#pragma once
+#include "ra/binary.hh"
+#include "ra/pool.hh"
+#include <stdexcept>
+
+namespace ra {
+
+// Read an array in slabs of up to rows along axis 0. After each call to next(), slab() is the current slab, and the
+// following one is being read into the other buffer. The stream mustn't be used otherwise until the reader is
+// destroyed. If the header isn't that of an array of T of rank RANK, the stream's failbit is set and next() returns
+// false. If the input ends before all the rows in its header have been read, next() throws.
+template <class T, rank_t RANK=RANK_ANY>
+struct SlabReader
+{
+    std::istream & i;
+    dim_t rows;
+    BinaryHeader h;
+    dim_t rowsize = 1, first = 0, count = 0;
+    Big<T, RANK> buffer[2];
+    int cur = 0;
+    ThreadPool & pool;
+    ThreadPool::Async pending;
+    dim_t pending_rows = 0;
+
+    SlabReader(std::istream & i_, dim_t rows_, ThreadPool & pool_=ThreadPool::current_pool())
+        : i(i_), rows(rows_), pool(pool_)
+    {
+        RA_CHECK(rows>0, "bad slab size ", rows);
+        if (read_binary_header(i, h, RANK==RANK_ANY ? binary_max_rank : RANK)) {
+            if (!check_binary_type<T>(h) || h.rank()<1 || (RANK!=RANK_ANY && RANK!=h.rank())) {
+                i.setstate(std::ios::failbit);
+                return;
+            }
+            std::vector<dim_t> s = h.shape;
+            s[0] = std::min(rows, s[0]);
+            for (rank_t k=1; k<h.rank(); ++k) {
+                rowsize *= s[k];
+            }
+            binary_resize(buffer[0], s);
+            binary_resize(buffer[1], s);
+            prefetch();
+        }
+    }
+    SlabReader(SlabReader const &) = delete;
+    SlabReader & operator=(SlabReader const &) = delete;
+
+// Start reading the slab that follows the current one into the other buffer.
+    void prefetch()
+    {
+        pending_rows = std::min(rows, h.shape[0]-(first+count));
+        if (pending_rows>0) {
+            pending = pool.async([this, k=pending_rows, p=buffer[1-cur].data()] { read_binary_block(i, p, k*rowsize, h.swap); });
+        }
+    }
+// Make the next slab current. Return false at the end of the array.
+    bool next()
+    {
+        if (!pending.valid()) {
+            return false;
+        }
+        pending.wait();
+        dim_t const k = pending_rows;
+        if (!i) {
+            throw std::runtime_error(format("cannot read input after ", first+count, " of ", h.shape[0], " rows"));
+        }
+        first += count;
+        count = k;
+        cur = 1-cur;
+        prefetch();
+        return true;
+    }
+// The current slab. It's valid until the next call to next().
+    auto slab() { return buffer[cur](ra::iota(count)); }
+// Shape of the whole array, and the position of the current slab along axis 0.
+    std::vector<dim_t> const & shape() const { return h.shape; }
+    dim_t position() const { return first; }
+};
+
+// Write an array with the given shape in slabs along axis 0. The header is written on construction. Each slab is
+// copied to a buffer that is written by a task on pool while the next slab is prepared. The stream mustn't be used
+// otherwise until close().
+template <class T, rank_t RANK=RANK_ANY>
+struct SlabWriter
+{
+    std::ostream & o;
+    std::vector<dim_t> s;
+    dim_t rows, written = 0;
+    Big<T, RANK> buffer[2];
+    int cur = 0;
+    ThreadPool & pool;
+    ThreadPool::Async pending;
+
+    SlabWriter(std::ostream & o_, std::vector<dim_t> s_, dim_t rows_, ThreadPool & pool_=ThreadPool::current_pool())
+        : o(o_), s(std::move(s_)), rows(rows_), pool(pool_)
+    {
+        RA_CHECK(rows>0, "bad slab size ", rows);
+        RA_CHECK(s.size()>=1 && (RANK==RANK_ANY || RANK==rank_t(s.size())), "bad rank ", s.size(), " for ", RANK);
+        write_binary_header(o, binary_header<T>(s));
+        std::vector<dim_t> sb = s;
+        sb[0] = std::min(rows, sb[0]);
+        binary_resize(buffer[0], sb);
+        binary_resize(buffer[1], sb);
+    }
+    SlabWriter(SlabWriter const &) = delete;
+    SlabWriter & operator=(SlabWriter const &) = delete;
+
+// Append the rows of a, which must have the shape of the array except along axis 0, and no more than rows of it.
+// a may be reused as soon as this returns.
+    template <class A>
+    SlabWriter & write(A && a)
+    {
+        auto const & sa = start(a);
+        RA_CHECK(sa.rank()==rank_t(s.size()), "rank ", sa.rank(), " should be ", s.size());
+        dim_t const k = sa.size(0);
+        RA_CHECK(k<=rows && written+k<=s[0], "too many rows ", k, " after ", written);
+        for (rank_t j=1; j<sa.rank(); ++j) {
+            RA_CHECK(sa.size(j)==s[j], "size ", sa.size(j), " on axis ", j, " should be ", s[j]);
+        }
+        if (k>0) {
+            auto v = buffer[cur](ra::iota(k));
+            v = a;
+            pending.wait();
+            pending = pool.async([this, v] { write_binary_data(o, v); });
+            written += k;
+            cur = 1-cur;
+        }
+        return *this;
+    }
+// Wait for the last slab to be written. All the rows of the array must have been written by then.
+    std::ostream & close()
+    {
+        pending.wait();
+        RA_CHECK(written==s[0], "only ", written, " rows of ", s[0], " were written");
+        return o;
+    }
+};
+
+// Call f on each slab of the array in i, in order. The next slab is read while f runs on the current one.
+template <class T, rank_t RANK=RANK_ANY, class F>
+inline std::istream &
+for_each_slab(std::istream & i, dim_t rows, F && f)
+{
+    SlabReader<T, RANK> r(i, rows);
+    while (r.next()) {
+        f(r.slab());
+    }
+    return i;
+}
+
+} // namespace ra
@@ -0,0 +1,167 @@
+// -*- mode: c++; coding: utf-8 -*-
+/// @file track.hh
+/// @brief Opt-in accounting of the allocations of Container storage.
+
+// This library is free software; you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option) any
+// later version.
+
+// Compiled out unless RA_DO_TRACK is 1. It must be defined the same way in every translation unit of a program.
+
+#pragma once
+#include <map>
+#include <mutex>
+#include <string>
+#include <cstddef>
+#include <algorithm>
+#include <iostream>
+#include <unordered_map>
+
+#ifndef RA_DO_TRACK
+#define RA_DO_TRACK 0
+#endif
+
+namespace ra {
+
+// Number of allocations and bytes allocated, and bytes currently allocated (live) and most ever (peak).
+struct TrackStats
+{
+    std::size_t count = 0, bytes = 0, live = 0, peak = 0;
+};
+
+inline std::ostream & operator<<(std::ostream & o, TrackStats const & s)
+{
+    return o << "count " << s.count << " bytes " << s.bytes << " live " << s.live << " peak " << s.peak;
+}
+
+struct TrackSnapshot
+{
+    TrackStats total;
+    std::map<std::string, TrackStats> tags; // by the tag of the innermost TrackScope; "" if there was none.
+};
+
+inline std::ostream & operator<<(std::ostream & o, TrackSnapshot const & s)
+{
+    o << "total: " << s.total;
+    for (auto const & [tag, t]: s.tags) {
+        o << "\n" << (tag.empty() ? "(untagged)" : tag) << ": " << t;
+    }
+    return o;
+}
+
+// Attribute the allocations made on this thread to tag until the end of the scope. report() gives the allocations
+// made in the scope so far, including those in nested scopes, with live and peak for the tag of the scope.
+struct TrackScope
+{
+    TrackScope * previous;
+    std::string tag;
+    std::size_t count = 0, bytes = 0;
+
+    explicit TrackScope(std::string tag_): previous(current), tag(std::move(tag_)) { current = this; }
+    TrackScope(TrackScope const &) = delete;
+    TrackScope & operator=(TrackScope const &) = delete;
+    ~TrackScope() { current = previous; }
+
+    TrackStats report() const;
+
+    static inline thread_local TrackScope * current = nullptr;
+};
+
+#if RA_DO_TRACK==1
+
+struct Tracker
+{
+    struct Block { std::size_t bytes; TrackStats * tag; };
+
+    std::mutex mutex;
+    TrackStats total;
+    std::map<std::string, TrackStats> tags;
+    std::unordered_map<void const *, Block> blocks;
+
+    static Tracker & get() { static Tracker t; return t; }
+};
+
+// p is null if the block can't be seen when it's freed. Then it's counted, but not in live or peak.
+inline void
+track_alloc(void const * p, std::size_t bytes)
+{
+    for (TrackScope * s=TrackScope::current; s; s=s->previous) {
+        ++(s->count);
+        s->bytes += bytes;
+    }
+    Tracker & t = Tracker::get();
+    std::lock_guard<std::mutex> lock(t.mutex);
+    TrackStats & tag = t.tags[TrackScope::current ? TrackScope::current->tag : std::string()];
+    for (TrackStats * s: { &t.total, &tag }) {
+        ++(s->count);
+        s->bytes += bytes;
+    }
+    if (p) {
+        t.blocks[p] = Tracker::Block { bytes, &tag };
+        for (TrackStats * s: { &t.total, &tag }) {
+            s->live += bytes;
+            s->peak = std::max(s->peak, s->live);
+        }
+    }
+}
+
+inline void
+track_free(void const * p)
+{
+    Tracker & t = Tracker::get();
+    std::lock_guard<std::mutex> lock(t.mutex);
+    if (auto i=t.blocks.find(p); i!=t.blocks.end()) {
+        t.total.live -= i->second.bytes;
+        i->second.tag->live -= i->second.bytes;
+        t.blocks.erase(i);
+    }
+}
+
+inline TrackSnapshot
+track_snapshot()
+{
+    Tracker & t = Tracker::get();
+    std::lock_guard<std::mutex> lock(t.mutex);
+    return TrackSnapshot { t.total, t.tags };
+}
+
+// Zero count and bytes, and bring peak down to live. Live blocks are still followed.
+inline void
+track_reset()
+{
+    Tracker & t = Tracker::get();
+    std::lock_guard<std::mutex> lock(t.mutex);
+    t.total = TrackStats { 0, 0, t.total.live, t.total.live };
+    for (auto & [tag, s]: t.tags) {
+        s = TrackStats { 0, 0, s.live, s.live };
+    }
+}
+
+inline TrackStats
+TrackScope::report() const
+{
+    Tracker & t = Tracker::get();
+    std::lock_guard<std::mutex> lock(t.mutex);
+    auto i = t.tags.find(tag);
+    return i==t.tags.end() ? TrackStats { count, bytes, 0, 0 } : TrackStats { count, bytes, i->second.live, i->second.peak };
+}
+
+#else
+
+inline void track_alloc(void const *, std::size_t) {}
+inline void track_free(void const *) {}
+inline TrackSnapshot track_snapshot() { return {}; }
+inline void track_reset() {}
+inline TrackStats TrackScope::report() const { return {}; }
+
+#endif // RA_DO_TRACK
+
+// Deleter for stores that take one, so that their blocks can be followed until they're freed.
+template <class T>
+struct track_delete
+{
+    void operator()(T * p) const { track_free(p); delete [] p; }
+};
+
+} // namespace ra
@@ -63,17 +63,29 @@ struct Reframe
             a.adv(l, d);
         }
     }
+    constexpr void jump(rank_t k, dim_t d)
+    {
+        if (int l = orig(k); l>=0) {
+            ra::jump(a, l, d);
+        }
+    }
     constexpr auto stride(int k) const
     {
         int l = orig(k);
         return l>=0 ? a.stride(l) : zerostride<decltype(a.stride(l))>::f();
     }
-    constexpr bool keep_stride(dim_t st, int z, int j) const
+    constexpr bool keep_stride(dim_t st, int z, int j) const requires (!StaticKeepStride<A>)
     {
         int wz = orig(z);
         int wj = orig(j);
         return wz>=0 && wj>=0 && a.keep_stride(st, wz, wj);
     }
+    constexpr static bool keep_stride(dim_t st, int z, int j) requires (StaticKeepStride<A>)
+    {
+        int wz = orig(z);
+        int wj = orig(j);
+        return wz>=0 && wj>=0 && std::decay_t<A>::keep_stride(st, wz, wj);
+    }
     template <class I> constexpr decltype(auto) at(I const & i)
     {
         return a.at(mp::map_indices<std::array<dim_t, mp::len<Dest>>, Dest>(i));
@@ -203,5 +203,50 @@ int main(int argc, char * * argv)
         std::array<int, 2> b = {2, 2};
         tr.test_eq(22, a.at(b));
     }
+    tr.section("construct elements in place");
+    {
+        static int made = 0;
+        struct T
+        {
+            double x;
+            T(): x(-1) { ++made; }
+            T(double x_): x(x_) {}
+            T(T const & t) = default;
+            T & operator=(T const & t) { x = t.x; ++made; return *this; }
+        };
+        auto x = [](auto && a) { return map([](T const & t) { return t.x; }, a); };
+        made = 0;
+        ra::Big<T, 2> a({2, 3}, ra::map([](int i, int j) { return T(i*3+j); }, ra::_0, ra::_1));
+        ra::Big<T> b({3, 2}, transpose<1, 0>(a));
+        ra::Big<T, 1> c({3}, {T(1), T(2), T(3)});
+// frame matching as in assignment.
+        ra::Big<T, 2> d({2, 3}, ra::map([](int i) { return T(i); }, ra::_0));
+        tr.test_eq(0, made);
+        tr.test_eq(ra::_0*3 + ra::_1, x(a));
+        tr.test_eq(ra::_1*3 + ra::_0, x(b));
+        tr.test_eq(ra::iota(3, 1), x(c));
+        tr.test_eq(ra::_0 + 0*ra::_1, x(d));
+// a source of higher rank visits each element several times, so the elements are default constructed and the source
+// is assigned to them, as it would be to a trivial type.
+        ra::Big<double, 2> h({2, 3}, ra::_0*3 + ra::_1);
+        ra::Big<double, 1> e({2}, h);
+        ra::Big<T, 1> f({2}, h);
+        tr.test_eq(2+2*3, made);
+        tr.test_eq(e, x(f));
+        ra::Big<T> g({2}, h);
+        tr.test_eq(e, x(g));
+// Unique still default constructs and assigns.
+        made = 0;
+        ra::Unique<T, 1> u({3}, {T(1), T(2), T(3)});
+        tr.test_eq(6, made);
+        tr.test_eq(ra::iota(3, 1), x(u));
+    }
+    tr.section("construct move-only elements in place");
+    {
+        ra::Big<std::unique_ptr<int>, 1> a({4}, ra::map([](int i) { return std::make_unique<int>(i); }, ra::_0));
+        tr.test_eq(ra::iota(4), map([](auto const & p) { return *p; }, a));
+        ra::Big<std::unique_ptr<int>> b({2, 2}, ra::map([](int i) { return std::make_unique<int>(i); }, ra::_0+2*ra::_1));
+        tr.test_eq(ra::_0+2*ra::_1, map([](auto const & p) { return *p; }, b));
+    }
     return tr.summary();
 }
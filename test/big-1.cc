@@ -12,6 +12,7 @@
 #include <iterator>
 #include "ra/ra.hh"
 #include "ra/test.hh"
+#include "ra/huge.hh"
 
 using std::cout, std::endl, std::flush, ra::TestRecorder;
 
@@ -163,5 +164,69 @@ int main()
         test_const(b, b.data()); // non-const to const, fixed rank to var rank
         test_const_ref(a, a.data()); // non-const to const, keeping var rank
     }
+    tr.section("aligned and padded storage");
+    {
+        auto aligned = [](auto * p, std::size_t align) { return 0==reinterpret_cast<std::uintptr_t>(p) % align; };
+        ra::Aligned<double, 2> a({3, 5}, ra::_0 - ra::_1);
+        tr.test(aligned(a.data(), 64));
+        tr.test_eq(5, a.stride(0));
+        tr.test_eq(ra::_0 - ra::_1, a);
+        ra::Aligned<float, 1, 256> b({7}, 3.f);
+        tr.test(aligned(b.data(), 256));
+        tr.test_eq(3.f, b);
+// rows are padded to 64 bytes.
+        ra::Padded<double, 3> c({2, 3, 5}, ra::_0 - ra::_1 + ra::_2);
+        tr.test_eq(ra::Small<int, 3> {24, 8, 1}, ra::map([&c](int k) { return c.stride(k); }, ra::iota(3)));
+        tr.test_eq(ra::_0 - ra::_1 + ra::_2, c);
+        tr.test_eq(sum(ra::Big<double, 3>({2, 3, 5}, ra::_0 - ra::_1 + ra::_2)), sum(c));
+        for (int i=0; i<2; ++i) {
+            for (int j=0; j<3; ++j) {
+                tr.test(aligned(&c(i, j, 0), 64));
+            }
+        }
+// and by one more cache line when the row is a multiple of pad_critical bytes.
+        ra::Padded<double, 2> d({3, 512}, 1.);
+        tr.test_eq(520, d.stride(0));
+        tr.test_eq(3*512, sum(d));
+// row-major initialization and copy skip the padding.
+        ra::Padded<int, 2> e({2, 3}, {1, 2, 3, 4, 5, 6});
+        tr.test_eq(ra::Small<int, 2, 3> {1, 2, 3, 4, 5, 6}, e);
+        tr.test_eq(16, e.stride(0));
+        ra::Padded<int, 2> f = e;
+        tr.test_eq(e, f);
+        tr.test_eq(ra::start({1, 2, 3, 4, 5, 6}), ra::start(std::vector<int>(f.begin(), f.end())));
+        f.resize(3);
+        tr.test_eq(ra::Small<int, 2> {3, 3}, shape(f));
+        tr.test_eq(16, f.stride(0));
+        tr.test_eq(e, f(ra::iota(2)));
+        ra::Padded<int> g({2, 3}, {1, 2, 3, 4, 5, 6});
+        tr.test_eq(e, g);
+        tr.test_eq(16, g.stride(0));
+        ra::View<int, 2> v = e;
+        tr.test_eq(e, v);
+    }
+    tr.section("huge page storage");
+    {
+        auto aligned = [](auto * p, std::size_t align) { return 0==reinterpret_cast<std::uintptr_t>(p) % align; };
+// small arrays don't get their own mapping.
+        ra::Huge<double, 2> a({3, 5}, ra::_0 - ra::_1);
+        tr.test(aligned(a.data(), 64));
+        tr.test_eq(ra::_0 - ra::_1, a);
+        ra::Huge<double, 3> b({7, 300, 200}, ra::_0 - ra::_1 + ra::_2);
+        tr.test(aligned(b.data(), ra::huge_page_size));
+        tr.test_eq(ra::_0 - ra::_1 + ra::_2, b);
+        ra::Huge<double, 3> c = b;
+        tr.test(aligned(c.data(), ra::huge_page_size));
+        tr.test_eq(b, c);
+        ra::Huge<float, ra::RANK_ANY, true> d({1000, 1000}, 2.f);
+        tr.test(aligned(d.data(), ra::huge_page_size));
+        tr.test_eq(2e6, sum(d));
+// first touch keeps the contents, whatever the pool.
+        ra::ThreadPool pool(3);
+        ra::first_touch(c.view(), ra::par(pool));
+        tr.test_eq(b, c);
+        ra::first_touch(a.view(), ra::par(pool, 7));
+        tr.test_eq(ra::_0 - ra::_1, a);
+    }
     return tr.summary();
 }
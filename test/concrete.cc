@@ -12,6 +12,7 @@
 #include "ra/test.hh"
 #include "ra/mpdebug.hh"
 #include <memory>
+#include <thread>
 
 using std::cout, std::endl;
 
@@ -151,5 +152,107 @@ int main()
         // cout << concrete(x*double(2.)) << endl; // FIXME fails [ra41]
         tr.test_eq(ra::Small<int, 1> {2}, ra::shape(x));
     }
+    tr.section("temporaries from an arena");
+    {
+        ra::Big<double, 2> a({100, 10}, ra::_0 + ra::_1);
+        ra::Big<double, 2> keep({100, 10}, 0.);
+        ra::Arena arena(4096);
+        for (int step=0; step<3; ++step) {
+            arena.reset();
+            ra::ArenaScope scope(arena);
+            auto b = arena_concrete(a*2.);
+            static_assert(std::is_same_v<ra::ArenaBig<double, 2>, decltype(b)>);
+            ra::ArenaBig<double, 1> d({7}, 3.);
+            auto s = arena_concrete(ra::Small<double, 2> {1., 2.}+1.);
+            static_assert(std::is_same_v<ra::Small<double, 2>, decltype(s)>);
+            tr.test_eq(2*(ra::_0 + ra::_1), b);
+            tr.test_eq(3., d);
+            tr.test_eq(ra::start({2., 3.}), s);
+            tr.test(&arena==b.store.get_allocator().arena);
+            tr.info("count ", arena.count()).test_eq(std::size_t(2), arena.count());
+            tr.info("bytes ", arena.bytes()).test_eq(std::size_t(8*(1000+7)), arena.bytes());
+// Big, and so concrete(), don't use the arena.
+            auto c = concrete(a*2.);
+            ra::Big<double, 1> e({10}, 0.);
+            tr.test_eq(std::size_t(2), arena.count());
+// arrays that are kept copy their contents out of the arena.
+            keep = b;
+            ra::ArenaBig<double, 2> copy = b;
+            tr.test(&arena==copy.store.get_allocator().arena);
+            tr.test(copy.data()!=b.data());
+            tr.test_eq(c, copy);
+        }
+        tr.test_eq(2*(ra::_0 + ra::_1), keep);
+        tr.test_le(arena.bytes(), arena.peak());
+        tr.test_le(arena.peak(), arena.capacity());
+        tr.test(nullptr==ra::Arena::current_arena);
+// the current arena is per thread.
+        ra::Arena * other = &arena;
+        {
+            ra::ArenaScope scope(arena);
+            std::thread([&other] { other = ra::Arena::current_arena; ra::ArenaBig<double, 1> f({10}, 0.); }).join();
+        }
+        tr.test(nullptr==other);
+    }
+    tr.section("functions that make arrays, with the result in an arena");
+    {
+        ra::Big<double, 2> a({3, 4}, ra::_0 - ra::_1);
+        ra::Big<double, 2> b({4, 2}, ra::_0 + 2*ra::_1);
+        ra::Big<double, 1> v({4}, ra::_0 + 1.);
+        ra::Big<double, 1> w({3}, ra::_0 - 1.);
+        ra::Arena arena(1<<16);
+        ra::ArenaScope scope(arena);
+        auto in_arena = [&arena](auto const & x) { return &arena==x.store.get_allocator().arena; };
+        auto c0 = with_same_shape<ra::ArenaBig>(a);
+        auto c1 = with_same_shape<ra::ArenaBig>(a, 7.);
+        auto c2 = ra::with_shape<ra::Big<int, 2>, ra::ArenaBig>({2, 5}, 3);
+        auto c3 = ra::with_shape<ra::Big<int, 1>, ra::ArenaBig>(ra::Small<int, 1> {6}, 1);
+        auto c4 = ra::concrete<ra::ArenaBig>(a+1.);
+        static_assert(std::is_same_v<ra::ArenaBig<double, 2>, decltype(c0)>);
+        static_assert(std::is_same_v<ra::ArenaBig<int, 2>, decltype(c2)>);
+        tr.test(in_arena(c0) && in_arena(c1) && in_arena(c2) && in_arena(c3) && in_arena(c4));
+        tr.test_eq(7., c1);
+        tr.test_eq(ra::start({2, 5}), ra::shape(c2));
+        tr.test_eq(1, c3);
+        tr.test_eq(a+1., c4);
+        auto n = normv<ra::ArenaBig>(v);
+        auto m = gemm<ra::ArenaBig>(a, b);
+        auto mv = gemv<ra::ArenaBig>(a, v);
+        auto vm = gevm<ra::ArenaBig>(w, a);
+        tr.test(in_arena(n) && in_arena(m) && in_arena(mv) && in_arena(vm));
+        tr.test_eq(normv(v), n);
+        tr.test_eq(gemm(a, b), m);
+        tr.test_eq(gemv(a, v), mv);
+        tr.test_eq(gevm(w, a), vm);
+// the default results are still Big.
+        static_assert(std::is_same_v<ra::Big<double, 2>, decltype(gemm(a, b))>);
+        static_assert(std::is_same_v<ra::Big<double, 1>, decltype(normv(v))>);
+        tr.test_eq(std::size_t(9), arena.count());
+    }
+    tr.section("swap between the heap and an arena");
+    {
+        ra::ArenaBig<double, 2> a({3, 4}, ra::_0 - ra::_1);
+        ra::ArenaBig<double, 1> c;
+        {
+            ra::Arena arena(4096);
+            ra::ArenaScope scope(arena);
+            ra::ArenaBig<double, 2> b({2, 2}, 7.);
+            tr.test(nullptr==a.store.get_allocator().arena);
+            tr.test(&arena==b.store.get_allocator().arena);
+            swap(a, b);
+            tr.test_eq(7., a);
+            tr.test_eq(ra::Small<int, 2> {2, 2}, shape(a));
+            tr.test_eq(ra::Big<double, 2>({3, 4}, ra::_0 - ra::_1), b);
+            tr.test(nullptr==a.store.get_allocator().arena);
+            tr.test(&arena==b.store.get_allocator().arena);
+// readers that allocate in the current scope and swap into the target.
+            std::istringstream s("3 1 2 3");
+            s >> c;
+            tr.test_eq(ra::start({1., 2., 3.}), c);
+            tr.test(nullptr==c.store.get_allocator().arena);
+        }
+        tr.test_eq(7., a);
+        tr.test_eq(ra::start({1., 2., 3.}), c);
+    }
     return tr.summary();
 }
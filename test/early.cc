@@ -34,5 +34,50 @@ int main()
         tr.test(!any(odd(a)));
         tr.test(every(!odd(a)));
     }
+    tr.section("static size");
+    {
+        ra::Small<int, 2, 3> a = ra::_0*2 + ra::_1*10;
+        tr.test(!any(odd(a)));
+        tr.test(every(!odd(a)));
+        a(1, 2) = 3;
+        tr.test(any(odd(a)));
+        tr.test(!every(!odd(a)));
+        tr.test(any(odd(transpose<1, 0>(a))));
+        ra::Small<int, 4> b = { 0, 7, 0, 7 };
+        tr.test_eq(1, index(b));
+        tr.test_eq(-1, index(b*0));
+        tr.test(ra::lexicographical_compare(ra::Small<int, 3> { 1, 2, 3 }, ra::Small<int, 3> { 1, 3, 0 }));
+        tr.test(!ra::lexicographical_compare(ra::Small<int, 3> { 1, 3, 3 }, ra::Small<int, 3> { 1, 2, 9 }));
+        ra::Small<int, 3, 3, 3> c = 0;
+        c(2, 1, 1) = 1;
+        tr.test(any(c==1));
+        tr.test(!any(c(ra::all, 0)==1));
+        ra::Small<int, 0> e;
+        tr.test(!any(e==1));
+        tr.test(every(e==1));
+    }
+    tr.section("parallel");
+    {
+        ra::Big<int, 2> a({1000, 10}, 0);
+        tr.test(!any(ra::par(4), a!=0));
+        tr.test(every(ra::par(4), a==0));
+        a(999, 9) = 1;
+        tr.test(any(ra::par(4), a!=0));
+        tr.test(!every(ra::par(4), a==0));
+        tr.test(any(ra::par(100), a(ra::all, 9)!=0));
+        tr.test(!any(ra::par(4), a(ra::iota(999), ra::all)!=0));
+        for (int k: {0, 123, 500, 998}) {
+            a(k, 3) = 1;
+            tr.info("first hit ", k).test_eq(k, early(ra::par(4), map([](int a, int i) { return std::make_tuple(a!=0, i); }, a, ra::_0), -1));
+            a(k, 3) = 0;
+        }
+        ra::Big<int, 2> b({0, 10}, 0);
+        tr.test(!any(ra::par(4), b==0));
+        ra::Big<int> c({10, 10}, 0); // var rank
+        c(9, 1) = 2;
+        tr.test(any(ra::par(3), c==2));
+        tr.test(any(ra::par, ra::Small<int, 3> { 0, 0, 1 }==1));
+        tr.test(any(ra::seq, a==1));
+    }
     return tr.summary();
 }
@@ -10,8 +10,15 @@
 
 #include <iostream>
 #include <iterator>
+#include <algorithm>
+#include <numeric>
+#include <iomanip>
+#include <limits>
+#include <cmath>
+#include <cstring>
 #include "ra/ra.hh"
 #include "ra/complex.hh"
+#include "ra/binary.hh"
 #include "ra/test.hh"
 
 using std::cout, std::endl, std::flush, ra::TestRecorder;
@@ -129,5 +136,365 @@ int main()
         ra::Small<ra::Big<double, 1>, 3> g = { { 1 }, { 1, 2 }, { 1, 2, 3 } };
         iocheck(tr.info("nested type"), g, g);
     }
+    tr.section("fast text input");
+    {
+        ra::Big<double, 3> a({3, 40, 50}, ra::_0*0.5 - ra::_1*2 + ra::_2*0.25);
+        ra::Big<int, 2> b({20, 30}, ra::_0 - ra::_1);
+        std::ostringstream o;
+        o << a << "\n" << b << "\n" << +1.5 << " " << ra::Small<int, 3> {1, 2, 3};
+        std::istringstream i(o.str());
+        ra::Big<double, 3> aa;
+        ra::Big<int, 2> bb;
+        double x;
+        ra::Small<int, 3> c;
+        i >> aa >> bb >> x >> c;
+        tr.test(bool(i));
+        tr.test_eq(a, aa);
+        tr.test_eq(b, bb);
+        tr.test_eq(1.5, x);
+        tr.test_eq(ra::start({1, 2, 3}), c);
+// with the right shape already, the storage is reused.
+        double const * p = aa.data();
+        std::istringstream j(o.str());
+        j >> aa;
+        tr.test(p==aa.data());
+        tr.test_eq(a, aa);
+    }
+    tr.section("fast text input, errors");
+    {
+        std::istringstream i("2 3\n1 2 3\n4 x 6\n");
+        ra::Big<int, 2> a;
+        ra::TextError e = read_text(i, a);
+        cout << e << endl;
+        tr.test(i.fail());
+        tr.test_eq(3, e.line);
+        tr.test_eq(3, e.column);
+        std::istringstream j("2 3\n  1 2 3\n4 +5 ");
+        e = read_text(j, a);
+        cout << e << endl;
+        tr.test(j.fail());
+        tr.test_eq(3, e.line);
+        tr.test_eq(6, e.column);
+        tr.test(e.what=="unexpected end of input");
+        std::istringstream k("-2 3");
+        e = read_text(k, a);
+        tr.test(bool(e));
+        tr.test_eq(1, e.line);
+        tr.test_eq(1, e.column);
+// negative rank, before anything is allocated.
+        std::istringstream l("-2 3 4");
+        ra::Big<int> b;
+        e = read_text(l, b);
+        tr.test(l.fail());
+        tr.test(e.what=="negative sizes in input");
+        tr.test_eq(1, e.column);
+        std::istringstream m("-2 3 4");
+        std::vector<int> v;
+        ra::operator>>(m, v);
+        tr.test(m.fail());
+        tr.test_eq(0, int(v.size()));
+    }
+    tr.section("text input doesn't overwrite shared storage");
+    {
+        ra::Shared<int, 1> a({3}, ra::_0);
+        ra::Shared<int, 1> b = a;
+        std::istringstream i("3 7 8 9");
+        i >> a;
+        tr.test(!i.fail());
+        tr.test_eq(ra::start({7, 8, 9}), a);
+        tr.test_eq(ra::start({0, 1, 2}), b);
+// unshared storage of the same shape is reused.
+        int const * p = a.data();
+        std::istringstream j("3 4 5 6");
+        j >> a;
+        tr.test_eq(ra::start({4, 5, 6}), a);
+        tr.test(p==a.data());
+    }
+    tr.section("fast text input, long tokens");
+    {
+        std::string const x = "1." + std::string(140, '0') + "5";
+        std::istringstream i("3 " + x + " 2 3");
+        ra::Big<double, 1> a;
+        i >> a;
+        tr.test(!i.fail());
+        tr.test_eq(ra::start({1., 2., 3.}), a);
+        std::istringstream j("3 " + x + " 2 3");
+        ra::Big<double, 1> b;
+        tr.test(!read_text(j, b, ra::par(2)));
+        tr.test_eq(ra::start({1., 2., 3.}), b);
+        std::istringstream k("2 3 " + x + "z 4");
+        ra::TextError e = read_text(k, a);
+        tr.test(k.fail());
+        tr.test_eq(5, e.column);
+        tr.test(e.what=="cannot read '" + x + "z'");
+    }
+    tr.section("fast text input, parallel");
+    {
+        ra::Big<double, 2> a({300, 200}, ra::_0*0.5 - ra::_1*2);
+        std::ostringstream o;
+        o << a << "\n";
+        for (int m: {1, 2, 3, 7}) {
+            std::istringstream i(o.str());
+            ra::Big<double, 2> b;
+            ra::TextError e = read_text(i, b, ra::par(m));
+            tr.info(m).test(!e);
+            tr.info(m).test_eq(a, b);
+        }
+        std::string s = o.str();
+        std::size_t const q = s.find("-199", s.size()/2);
+        s.replace(q, 4, "-1z9");
+        ra::dim_t const line = 1+std::count(s.begin(), s.begin()+q, '\n');
+        ra::dim_t const column = q-s.rfind('\n', q);
+        for (int m: {1, 2, 3, 7}) {
+            std::istringstream i(s);
+            ra::Big<double, 2> b;
+            ra::TextError e = read_text(i, b, ra::par(m));
+            tr.info(m, " ", e).test(i.fail());
+            tr.info(m).test_eq(line, e.line);
+            tr.info(m).test_eq(column, e.column);
+        }
+        std::istringstream i(o.str().substr(0, o.str().size()-100));
+        ra::Big<double, 2> b;
+        ra::TextError e = read_text(i, b, ra::par(3));
+        tr.test(e.what=="unexpected end of input");
+        tr.test_eq(301, e.line);
+    }
+    tr.section("fast text output, same as formatted output");
+    {
+// write_text without a format uses operator<< on each element.
+        auto both = [&](auto && a, auto && setup)
+        {
+            std::ostringstream o, p;
+            setup(o);
+            setup(p);
+            o << a << "|";
+            write_text(p, format_array(a), std::nullopt) << "|";
+            tr.info(o.str()).test_eq(p.str(), o.str());
+        };
+        double const x = std::numeric_limits<double>::infinity();
+        ra::Big<double, 2> a({4, 4}, {0., -0., 0.1, 1./3, 1e-7, 1e20, 123456789., -2.5e-300,
+                                      x, -x, std::nan(""), 1e300, 100000., 1000000., 1.5, -7.});
+        auto none = [](auto & o) {};
+        both(a, none);
+        both(a, [](auto & o) { o.precision(17); });
+        both(a, [](auto & o) { o.precision(0); });
+        both(a, [](auto & o) { o.precision(3); o.setf(std::ios::fixed, std::ios::floatfield); });
+        both(a, [](auto & o) { o.setf(std::ios::scientific, std::ios::floatfield); });
+        both(a, [](auto & o) { o << std::showpos; });
+        both(a, [](auto & o) { o << std::hexfloat; });
+        both(ra::Big<float>({2, 2}, {0.1f, 1e30f, 3.f, -1/3.f}), none);
+        both(ra::Big<long double, 1>({2}, {0.1L, 1e1000L}), none);
+        both(ra::Big<int, 3>({2, 3, 2}, ra::_0 - ra::_1*ra::_2), none);
+        both(ra::Big<int, 3>({2, 3, 2}, ra::_0 - ra::_1*ra::_2), [](auto & o) { o << std::hex; });
+        both(ra::Small<unsigned, 2, 3> {1, 2, 3, 4, 5, 99999}, none);
+        both(ra::Big<std::size_t, 4>({2, 1, 2, 3}, ra::_3), none);
+        both(ra::Big<int, 2>({2, 0}, 0), none);
+        both(ra::Big<int, 0>({}, 7), none);
+        both(ra::Big<double>({3, 2}, ra::_0 - ra::_1*.5), none);
+        both(ra::iota(5, 3), none);
+        both(ra::Big<char, 1>({3}, 'a'), none);
+        both(ra::Unique<bool, 1> {true, false}, none);
+        both(ra::Big<std::complex<double>, 1>({2}, std::complex<double>(1, 2)), none);
+        std::ostringstream o;
+        o << std::setw(4) << ra::Small<int, 3> {1, 2, 3};
+        tr.test_eq(std::string("   1 2 3"), o.str());
+    }
+    tr.section("fast text output, format and separators");
+    {
+        ra::Big<double, 3> a({2, 2, 2}, ra::_0 + ra::_1*0.1 + ra::_2/3.);
+        std::ostringstream o;
+        write_text(o, format_array(a, ",", ";", "/"), ra::TextFormat { std::chars_format::fixed, 2 });
+        tr.test_eq(std::string("2 2 2\n0.00,0.33;0.10,0.43//1.00,1.33;1.10,1.43"), o.str());
+// shortest, reads back exactly.
+        std::stringstream s;
+        write_text(s, format_array(a), ra::TextFormat { std::chars_format::general, -1 });
+        ra::Big<double, 3> b;
+        s >> b;
+        tr.test_eq(0, b-a);
+        tr.test(std::string::npos!=s.str().find("\n0.1 "));
+    }
+    tr.section("fast text output, parallel");
+    {
+// rows*threads over ra::text_slab, so that there are several rounds of slabs.
+        for (int m: {1, 2, 3, 7}) {
+            for (ra::dim_t rows: {1, 5, 100000}) {
+                ra::Big<double, 3> a({rows, 2, 1}, ra::_0*0.5 - ra::_1*(1/3.));
+                std::ostringstream o, p;
+                o << a;
+                write_text(p, format_array(a), ra::text_format(p), ra::par(m));
+                tr.info(m, " ", rows).test(o.str()==p.str());
+            }
+            ra::Big<int, 1> b({200000}, ra::_0);
+            std::ostringstream o, p;
+            o << format_array(b, ",");
+            write_text(p, format_array(b, ","), ra::TextFormat {}, ra::par(m));
+            tr.info(m).test(o.str()==p.str());
+// a leaf that only steps by 1 in plain traversal.
+            std::vector<int> v(200000);
+            std::iota(v.begin(), v.end(), 0);
+            std::ostringstream q;
+            write_text(q, format_array(ra::start(v), ","), ra::TextFormat {}, ra::par(m));
+            tr.info(m, " Vector").test(o.str()==q.str());
+        }
+    }
+    tr.section("binary, contiguous");
+    {
+        ra::Big<double, 3> a({2, 3, 4}, ra::_0*100 + ra::_1*10 + ra::_2);
+        std::stringstream s;
+        write_binary(s, a);
+        tr.test_eq(8+4+4+4+4+8+16*3+24*8, int(s.str().size()));
+        ra::Big<double, 3> b;
+        read_binary(s, b);
+        tr.test(bool(s));
+        tr.test_eq(a, b);
+        ra::Big<double> c;
+        s.seekg(0);
+        read_binary(s, c);
+        tr.test_eq(3, c.rank());
+        tr.test_eq(a, c);
+    }
+    tr.section("binary, strided views and expressions");
+    {
+        ra::Big<int, 2> a({7, 5}, ra::_0 - ra::_1);
+        std::stringstream s;
+        write_binary(s, transpose<1, 0>(a));
+        write_binary(s, a+1);
+        ra::write_binary(s, std::vector<int> {1, 2, 3});
+        ra::Big<int, 2> b;
+        read_binary(s, b);
+        tr.test_eq(transpose<1, 0>(a), b);
+// strided target of fixed size
+        ra::Big<int, 2> c({7, 5}, 0);
+        s.seekg(0);
+        auto ct = transpose<1, 0>(c);
+        read_binary(s, ct);
+        tr.test_eq(a, c);
+        read_binary(s, c);
+        tr.test_eq(a+1, c);
+        ra::Big<int, 1> d;
+        read_binary(s, d);
+        tr.test_eq(ra::start({1, 2, 3}), d);
+    }
+    tr.section("binary, chunked gather");
+    {
+        ra::Big<float, 2> a({3, 2*ra::binary_chunk+7}, ra::_0 + ra::_1);
+        std::stringstream s;
+        write_binary(s, a(ra::all, ra::iota(ra::binary_chunk+4, 0, 2)));
+        ra::Big<float, 2> b;
+        read_binary(s, b);
+        tr.test_eq(a(ra::all, ra::iota(ra::binary_chunk+4, 0, 2)), b);
+        ra::Big<float, 2> c({3, 2*ra::binary_chunk+8}, 0.f);
+        s.seekg(0);
+        auto cc = c(ra::all, ra::iota(ra::binary_chunk+4, 1, 2));
+        read_binary(s, cc);
+        tr.test_eq(b, cc);
+        tr.test_eq(0.f, c(ra::all, ra::iota(ra::binary_chunk+4, 0, 2)));
+    }
+    tr.section("binary, complex and byte order");
+    {
+        using complex = std::complex<double>;
+        ra::Big<complex, 1> a = { complex(0, 1), complex(1, 2), complex(2, 3) };
+        ra::BinaryHeader h = ra::binary_header<complex>({3});
+        std::vector<complex> x(a.begin(), a.end());
+// write as if from a machine with the opposite byte order
+        std::uint32_t const order = ra::binary_byteswap(ra::binary_order), version = ra::binary_byteswap(ra::binary_version);
+        std::uint32_t const kind = ra::binary_byteswap(std::uint32_t('c')), elsize = ra::binary_byteswap(std::uint32_t(16));
+        std::int64_t const rank = ra::binary_byteswap(std::int64_t(1)), size = ra::binary_byteswap(std::int64_t(3));
+        std::int64_t const stride = ra::binary_byteswap(std::int64_t(1));
+        ra::binary_swap((char *)x.data(), 6, 8);
+        std::stringstream s;
+        s.write(ra::binary_magic, 8);
+        for (auto const & [p, n]: { std::pair { (char const *)&order, 4 }, { (char const *)&version, 4 },
+                                    { (char const *)&kind, 4 }, { (char const *)&elsize, 4 }, { (char const *)&rank, 8 },
+                                    { (char const *)&size, 8 }, { (char const *)&stride, 8 },
+                                    { (char const *)x.data(), 48 } }) {
+            s.write(p, n);
+        }
+        ra::Big<complex, 1> b;
+        read_binary(s, b);
+        tr.test(bool(s));
+        tr.test_eq(a, b);
+        tr.test_eq(h.bytes()+48, s.str().size());
+    }
+    tr.section("binary, bad input");
+    {
+        std::stringstream s("ra::text and so on");
+        ra::Big<int> a;
+        read_binary(s, a);
+        tr.test(s.fail());
+    }
+    tr.section("binary, bad rank");
+    {
+        auto with_rank = [](std::int64_t rank)
+        {
+            std::stringstream s;
+            write_binary(s, ra::Big<int, 2>({2, 3}, ra::_0 - ra::_1));
+            std::string b = s.str();
+            std::memcpy(b.data()+24, &rank, 8);
+            return std::stringstream(b);
+        };
+        {
+            auto s = with_rank(std::int64_t(1)<<40);
+            ra::Big<int> a;
+            read_binary(s, a);
+            tr.test(s.fail());
+        }
+        {
+            auto s = with_rank(ra::binary_max_rank+1);
+            ra::Big<int> a;
+            read_binary(s, a);
+            tr.test(s.fail());
+        }
+        {
+            auto s = with_rank(3);
+            ra::Big<int, 2> a;
+            read_binary(s, a);
+            tr.test(s.fail());
+        }
+        {
+            auto s = with_rank(2);
+            ra::Big<int, 2> a;
+            read_binary(s, a);
+            tr.test(!s.fail());
+            tr.test_eq(ra::_0 - ra::_1, a);
+        }
+    }
+    tr.section("binary, header doesn't match the array");
+    {
+        auto written = [](auto && a)
+        {
+            std::stringstream s;
+            write_binary(s, a);
+            return s.str();
+        };
+        auto fails = [](std::string const & b, auto && a)
+        {
+            std::stringstream s(b);
+            read_binary(s, a);
+            return s.fail();
+        };
+        std::string const b = written(ra::Big<float, 2>({2, 3}, ra::_0 - ra::_1));
+        tr.test(!fails(b, ra::Big<float, 2>()));
+        tr.info("element type").test(fails(b, ra::Big<double, 2>()));
+        tr.info("element type").test(fails(b, ra::Big<int, 2>()));
+        tr.info("rank").test(fails(b, ra::Big<float, 1>()));
+        tr.info("rank").test(fails(b, ra::Small<float, 6>()));
+        tr.info("size").test(fails(b, ra::Small<float, 3, 2>()));
+        tr.test(!fails(b, ra::Small<float, 2, 3>()));
+// strides that aren't row-major.
+        std::string c = b;
+        std::int64_t const stride[2] = { 1, 2 };
+        std::memcpy(c.data()+48, stride, 16);
+        tr.info("strides").test(fails(c, ra::Big<float, 2>()));
+        {
+            ra::Small<float, 3, 2> a(7.f);
+            fails(b, a);
+            tr.info("nothing is read").test_eq(7.f, a);
+            ra::Big<double, 2> c({2, 2}, 7.);
+            fails(b, c);
+            tr.info("nothing is read").test_eq(ra::start({2, 2}), ra::shape(c));
+            tr.info("nothing is read").test_eq(7., c);
+        }
+    }
     return tr.summary();
 }
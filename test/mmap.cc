@@ -0,0 +1,125 @@
+// -*- mode: c++; coding: utf-8 -*-
+/// @file mmap.cc
+/// @brief Tests for arrays backed by memory-mapped files.
+
+// This library is free software; you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option) any
+// later version.
+
+#include <cstdio>
+#include <string>
+#include <filesystem>
+#include "ra/ra.hh"
+#include "ra/mmap.hh"
+#include "ra/test.hh"
+
+using std::cout, std::endl, ra::TestRecorder;
+
+int main()
+{
+    TestRecorder tr(std::cout);
+    std::string name = "ra-test-mmap-" + std::to_string(getpid());
+    tr.section("create, write, read back");
+    {
+        {
+            auto a = ra::mmap_create<double, 2>(name.c_str(), {3, 4});
+            tr.test_eq(ra::Small<int, 2> {3, 4}, shape(a));
+            tr.test_eq(0., a);
+            tr.test(0==reinterpret_cast<std::uintptr_t>(a.data()) % ra::mmap_align);
+            a = ra::_0 - ra::_1;
+            ra::mmap_sync(a);
+        }
+        {
+            auto b = ra::mmap_open<double const, 2>(name.c_str(), ra::mmap_advice::sequential);
+            tr.test_eq(ra::_0 - ra::_1, b);
+            tr.test_eq(sum(ra::Big<double, 2>({3, 4}, ra::_0 - ra::_1)), sum(b));
+        }
+    }
+    tr.section("var rank, read-write");
+    {
+        {
+            auto a = ra::mmap_open<double>(name.c_str(), ra::mmap_advice::random);
+            tr.test_eq(2, rank(a));
+            tr.test_eq(ra::start({3, 4}), shape(a));
+            a(1, 2) = 99;
+            ra::mmap_advise(a, ra::mmap_advice::normal);
+            ra::mmap_sync(a, false);
+// views and copies of the store keep the mapping alive.
+            ra::Shared<double> c = a;
+            a = ra::Shared<double>();
+            tr.test_eq(99, c(1, 2));
+        }
+        {
+            auto b = ra::mmap_open<double const, 2>(name.c_str());
+            tr.test_eq(99, b(1, 2));
+            tr.test_eq(0-3, b(0, 3));
+        }
+    }
+    tr.section("empty arrays and other ranks");
+    {
+        {
+            auto a = ra::mmap_create<int, 1>(name.c_str(), {0});
+            tr.test_eq(0, a.size());
+        }
+        tr.test_eq(0, ra::mmap_open<int const, 1>(name.c_str()).size());
+        {
+            auto a = ra::mmap_create<int>(name.c_str(), ra::Small<int, 3> {2, 3, 4});
+            a = ra::_0 + 10*ra::_1 + 100*ra::_2;
+        }
+        auto b = ra::mmap_open<int const, 3>(name.c_str());
+        tr.test_eq(ra::_0 + 10*ra::_1 + 100*ra::_2, b);
+    }
+    tr.section("errors are reported even without RA_CHECK, and leave nothing open");
+    {
+        auto open_fds = [] { int n = 0; for ([[maybe_unused]] auto & e: std::filesystem::directory_iterator("/proc/self/fd")) { ++n; } return n; };
+        auto fails = [&](auto && f) { try { f(); return false; } catch (std::exception & e) { cout << e.what() << endl; return true; } };
+        int const fds = open_fds();
+        tr.test(fails([&] { ra::mmap_open<int const>((name + "-missing").c_str()); }));
+        ra::mmap_create<int, 2>(name.c_str(), {2, 3});
+        tr.test(fails([&] { ra::mmap_open<double const>(name.c_str()); }));
+        tr.test(fails([&] { ra::mmap_open<int const, 1>(name.c_str()); }));
+        tr.test(!fails([&] { ra::mmap_open<int const, 2>(name.c_str()); }));
+        auto poke = [&](long offset, std::int64_t x)
+        {
+            std::FILE * f = std::fopen(name.c_str(), "r+b");
+            std::fseek(f, offset, SEEK_SET);
+            std::fwrite(&x, 8, 1, f);
+            std::fclose(f);
+        };
+        ra::mmap_create<std::int64_t, 1>(name.c_str(), {3});
+        poke(24, 4);
+        tr.test(fails([&] { ra::mmap_open<std::int64_t const, 1>(name.c_str()); }));
+        poke(24, -1);
+        tr.test(fails([&] { ra::mmap_open<std::int64_t const, 1>(name.c_str()); }));
+        poke(24, 3);
+        tr.test(!fails([&] { ra::mmap_open<std::int64_t const, 1>(name.c_str()); }));
+        tr.test_eq(0, truncate(name.c_str(), ra::mmap_data_offset(1)+8));
+        tr.test(fails([&] { ra::mmap_open<std::int64_t const, 1>(name.c_str()); }));
+// rank in the header goes past the end of the file.
+        poke(16, 1<<30);
+        tr.test(fails([&] { ra::mmap_open<std::int64_t const>(name.c_str()); }));
+        tr.test_eq(0, truncate(name.c_str(), 8));
+        tr.test(fails([&] { ra::mmap_open<std::int64_t const>(name.c_str()); }));
+        tr.test_eq(fds, open_fds());
+// arrays that aren't mapped.
+        ra::Shared<int, 1> b;
+        tr.test(fails([&] { ra::mmap_sync(b); }));
+        tr.test(fails([&] { ra::mmap_advise(b, ra::mmap_advice::random); }));
+// madvise fails on an address that isn't page aligned. munmap fails on it too, harmlessly.
+        int buf[4];
+        ra::Shared<int, 1> c;
+        c.dim = ra::View<int, 1>({3}, buf+1).dim;
+        c.p = buf+1;
+        c.store = std::shared_ptr<int>(buf+1, ra::MmapDeleter { (char *)(buf)+1, sizeof(int) });
+        bool syserr = false;
+        try {
+            ra::mmap_advise(c, ra::mmap_advice::random);
+        } catch (std::system_error & e) {
+            syserr = true;
+        }
+        tr.test(syserr);
+    }
+    std::remove(name.c_str());
+    return tr.summary();
+}
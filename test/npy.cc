@@ -0,0 +1,300 @@
+// -*- mode: c++; coding: utf-8 -*-
+/// @file npy.cc
+/// @brief Tests for NumPy .npy and .npz files.
+
+// This library is free software; you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option) any
+// later version.
+
+#include <cstdio>
+#include <string>
+#include <sstream>
+#include <algorithm>
+#include "ra/test.hh"
+#include "ra/ra.hh"
+#include "ra/complex.hh"
+#include "ra/npy.hh"
+
+using std::cout, std::endl, ra::TestRecorder;
+using complex = std::complex<double>;
+
+int main()
+{
+    TestRecorder tr(std::cout);
+    std::string name = "ra-test-npy-" + std::to_string(getpid());
+    tr.section("header as numpy.save writes it");
+    {
+        ra::Big<double, 2> a({2, 3}, ra::_0*3 + ra::_1);
+        std::ostringstream o;
+        write_npy(o, a);
+        std::string const s = o.str();
+        tr.test_eq(128+6*8, int(s.size()));
+        std::string const d = "{'descr': '<f8', 'fortran_order': False, 'shape': (2, 3), }";
+        tr.test_eq(std::string("\x93NUMPY\x01\x00\x76\x00", 10), s.substr(0, 10));
+        tr.test_eq(d, s.substr(10, d.size()));
+        tr.test_eq(std::string(128-10-d.size()-1, ' ') + "\n", s.substr(10+d.size(), 128-10-d.size()));
+        tr.test_eq(std::string((char const *)a.data(), 48), s.substr(128));
+        auto shape_str = [](auto && b) { std::ostringstream o; write_npy(o, b); return o.str(); };
+        tr.test(std::string::npos!=shape_str(ra::Big<int>({}, 0)).find("'shape': (), }"));
+        tr.test(std::string::npos!=shape_str(ra::Big<int>({7}, 0)).find("'shape': (7,), }"));
+    }
+    tr.section("round trip");
+    {
+        ra::Big<complex, 3> a({2, 3, 4}, ra::_0 + ra::_1*ra::_2);
+        a += complex(0, 1)*(ra::_2*1.);
+        std::stringstream s;
+        write_npy(s, a);
+        write_npy(s, a(ra::all, 1));
+        write_npy(s, ra::Unique<bool, 1> {true, false, true});
+        ra::Big<complex> b;
+        read_npy(s, b);
+        tr.test_eq(a, b);
+        ra::Big<complex, 2> c;
+        read_npy(s, c);
+        tr.test_eq(a(ra::all, 1), c);
+        ra::Unique<bool, 1> d;
+        read_npy(s, d);
+        tr.test_eq(ra::start({true, false, true}), d);
+        tr.test(bool(s));
+    }
+    tr.section("Fortran order");
+    {
+        ra::Big<int, 2> a({3, 4}, ra::_0*4 + ra::_1);
+        std::stringstream s;
+// the transpose is written as is, with fortran_order.
+        write_npy(s, transpose<1, 0>(a));
+        tr.test(std::string::npos!=s.str().find("'fortran_order': True, 'shape': (4, 3), }"));
+        tr.test_eq(std::string((char const *)a.data(), 48), s.str().substr(s.str().size()-48));
+        ra::Big<int, 2> b;
+        read_npy(s, b);
+        tr.test_eq(transpose<1, 0>(a), b);
+// read into a non-contiguous view.
+        ra::Big<int, 2> c({4, 6}, 0);
+        s.seekg(0);
+        auto cv = c(ra::all, ra::iota(3, 0, 2));
+        read_npy(s, cv);
+        tr.test_eq(transpose<1, 0>(a), c(ra::all, ra::iota(3, 0, 2)));
+        tr.test_eq(0, c(ra::all, ra::iota(3, 1, 2)));
+    }
+    tr.section("foreign byte order");
+    {
+        std::ostringstream o;
+        write_npy_header(o, ra::NpyHeader { std::endian::native==std::endian::little ? ">i4" : "<i4", false, {3} });
+        for (std::int32_t x: {1, 2, 300}) {
+            x = ra::binary_byteswap(x);
+            o.write((char const *)&x, 4);
+        }
+        std::istringstream i(o.str());
+        ra::Big<std::int32_t, 1> a;
+        read_npy(i, a);
+        tr.test_eq(ra::start({1, 2, 300}), a);
+    }
+    tr.section("bad input");
+    {
+        std::istringstream i("\x93NUMPZ\x01\x00");
+        ra::Big<int> a;
+        read_npy(i, a);
+        tr.test(i.fail());
+    }
+    tr.section("header doesn't match the array");
+    {
+        auto written = [](auto && a) { std::ostringstream o; write_npy(o, a); return o.str(); };
+        auto fails = [](std::string const & b, auto && a) { std::istringstream i(b); read_npy(i, a); return i.fail(); };
+        ra::Big<int, 2> a({3, 4}, ra::_0*4 + ra::_1);
+        std::string const b = written(a);
+        tr.test(!fails(b, ra::Big<int, 2>()));
+        tr.info("element type").test(fails(b, ra::Big<double, 2>()));
+        tr.info("element type").test(fails(b, ra::Big<unsigned, 2>()));
+        tr.info("rank").test(fails(b, ra::Big<int, 1>()));
+        tr.info("size").test(fails(b, ra::Small<int, 4, 3>()));
+        tr.test(!fails(b, ra::Small<int, 3, 4>()));
+// Fortran order needs a dope vector.
+        std::string const bt = written(transpose<1, 0>(a));
+        tr.test(!fails(bt, ra::Big<int, 2>()));
+        ra::Small<int, 4, 3> c(7);
+        tr.info("Fortran order").test(fails(bt, c));
+        tr.info("nothing is read").test(std::all_of(c.begin(), c.end(), [](int x) { return x==7; }));
+        ra::Big<double, 2> d({2, 2}, 7.);
+        tr.test(fails(b, d));
+        tr.info("nothing is read").test_eq(ra::start({2, 2}), ra::shape(d));
+    }
+    tr.section("mapped, without copy");
+    {
+        ra::Big<float, 3> a({2, 3, 4}, ra::_0 - ra::_1 + ra::_2);
+        {
+            std::ofstream o(name, std::ios::binary);
+            write_npy(o, a);
+        }
+        auto b = ra::npy_open<float const, 3>(name.c_str());
+        tr.test_eq(a, b);
+        tr.test(0==reinterpret_cast<std::uintptr_t>(b.data()) % ra::npy_align);
+        {
+            auto c = ra::npy_open<float>(name.c_str());
+            tr.test_eq(3, c.rank());
+            c(1, 2, 3) = 99;
+        }
+        tr.test_eq(99, b(1, 2, 3));
+        {
+            std::ofstream o(name, std::ios::binary);
+            write_npy(o, transpose<2, 1, 0>(a));
+        }
+        auto d = ra::npy_open<float const, 3>(name.c_str());
+        tr.test_eq(transpose<2, 1, 0>(a), d);
+        tr.test_eq(1, d.stride(0));
+        tr.test_eq(12, d.stride(2));
+        std::remove(name.c_str());
+    }
+    tr.section("npz");
+    {
+        ra::Big<double, 2> a({3, 4}, ra::_0 - ra::_1);
+        ra::Big<int, 1> b = {1, 2, 3};
+        {
+            std::ofstream o(name, std::ios::binary);
+            ra::NpzWriter w(o);
+            w.add("a", a).add("b", b).add("at", transpose<1, 0>(a));
+            w.close();
+        }
+        std::ifstream i(name, std::ios::binary);
+        auto keys = ra::npz_keys(i);
+        tr.test_eq(3, int(keys.size()));
+        tr.test(keys[0]=="a" && keys[1]=="b" && keys[2]=="at");
+        ra::Big<int, 1> bb;
+        read_npz(i, "b", bb);
+        tr.test_eq(b, bb);
+        ra::Big<double, 2> aa, aat;
+        read_npz(i, "a", aa);
+        read_npz(i, "at", aat);
+        tr.test_eq(a, aa);
+        tr.test_eq(transpose<1, 0>(a), aat);
+// CRC-32 check value.
+        std::ostringstream o;
+        ra::CrcBuf crc(o.rdbuf());
+        std::ostream(&crc) << "123456789";
+        tr.test_eq(0xcbf43926u, crc.value());
+        tr.test_eq(std::string("123456789"), o.str());
+// missing key.
+        i.clear();
+        ra::Big<int, 1> c;
+        read_npz(i, "c", c);
+        tr.test(i.fail());
+        std::remove(name.c_str());
+    }
+    tr.section("npz, offsets of 4 GiB or more");
+    {
+// a stream whose positions start at 4 GiB, so that nothing has to be written to get there.
+        struct FarBuf: std::stringbuf
+        {
+            std::streamoff const base = 0x100000000;
+            pos_type seekoff(off_type off, std::ios::seekdir dir, std::ios::openmode which) override
+            {
+                pos_type p = std::stringbuf::seekoff(off, dir, which);
+                return p==pos_type(off_type(-1)) ? p : pos_type(p+base);
+            }
+            pos_type seekpos(pos_type p, std::ios::openmode which) override
+            {
+                return std::stringbuf::seekpos(p-base, which);
+            }
+        };
+        FarBuf buf;
+        std::ostream o(&buf);
+        ra::NpzWriter w(o);
+        w.add("a", ra::Big<int, 1>({3}, 0));
+        tr.test(o.fail());
+        tr.test_eq(0, int(w.entries.size()));
+        tr.test_eq(0, int(buf.str().size()));
+        o.clear();
+        w.close();
+        tr.test(o.fail());
+        tr.test_eq(0, int(buf.str().size()));
+    }
+    tr.section("npz, zip64 extra field");
+    {
+// an archive with the offset of its one file in the zip64 extra field.
+        auto npz = [](std::string const & extra)
+        {
+            std::stringstream o;
+            ra::NpzWriter w(o);
+            w.add("b", ra::Big<int, 1> {1, 2, 3});
+            w.close();
+            std::string const s = o.str();
+            std::size_t const e = s.rfind("PK\x05\x06");
+            std::size_t const c = ra::zip_get(s.data()+e+16, 4);
+            std::string entry = s.substr(c, 46+5);
+            std::string x, dsize;
+            ra::zip_put<2>(x, extra.size());
+            entry.replace(30, 2, x);
+            entry.replace(42, 4, std::string(4, '\xff'));
+            ra::zip_put<4>(dsize, entry.size()+extra.size());
+            std::string end = s.substr(e);
+            end.replace(12, 4, dsize);
+            return std::istringstream(s.substr(0, c) + entry + extra + end);
+        };
+        auto record = [](int id, int len, std::string const & data)
+        {
+            std::string r;
+            ra::zip_put<2>(r, id);
+            ra::zip_put<2>(r, len);
+            return r + data;
+        };
+        std::string const zero8(8, '\0');
+        {
+            auto i = npz(record(0x7075, 2, "ab") + record(1, 8, zero8));
+            ra::Big<int, 1> b;
+            read_npz(i, "b", b);
+            tr.test(!i.fail());
+            tr.test_eq(ra::start({1, 2, 3}), b);
+        }
+        for (std::string const & extra: { record(1, 8, zero8.substr(0, 4)), // past the end of the extra field.
+                                          record(1, 4, zero8.substr(0, 4)), // too short for the offset.
+                                          record(0x7075, 2, "ab"), // no zip64 record.
+                                          record(0x7075, 200, "ab") + record(1, 8, zero8) }) {
+            auto i = npz(extra);
+            tr.test_eq(0, int(ra::npz_keys(i).size()));
+            tr.test(i.fail());
+            i.clear();
+            ra::Big<int, 1> b;
+            read_npz(i, "b", b);
+            tr.test(i.fail());
+        }
+// directory past the end of the file.
+        {
+            auto i = npz(record(1, 8, zero8));
+            std::string s = i.str();
+            std::string x;
+            ra::zip_put<4>(x, 1000);
+            s.replace(s.size()-22+12, 4, x);
+            std::istringstream j(s);
+            tr.test_eq(0, int(ra::npz_keys(j).size()));
+            tr.test(j.fail());
+        }
+    }
+    tr.section("mapped, errors");
+    {
+        {
+            std::ofstream o(name, std::ios::binary);
+            write_npy(o, ra::Big<int, 1>({100}, 0));
+        }
+        tr.test_eq(0, truncate(name.c_str(), 200));
+        bool threw = false;
+        try {
+            ra::npy_open<int const, 1>(name.c_str());
+        } catch (std::runtime_error & e) {
+            threw = true;
+        }
+        tr.test(threw);
+        {
+            std::ofstream o(name, std::ios::binary);
+            write_npy(o, ra::Big<int, 1>({100}, 0));
+        }
+        threw = false;
+        try {
+            ra::npy_open<float const, 1>(name.c_str());
+        } catch (std::runtime_error & e) {
+            threw = true;
+        }
+        tr.info("element type").test(threw);
+        std::remove(name.c_str());
+    }
+    return tr.summary();
+}
@@ -9,6 +9,9 @@
 // later version.
 
 #include <iostream>
+#include <set>
+#include <numeric>
+#include <algorithm>
 #include "ra/complex.hh"
 #include "ra/test.hh"
 #include "ra/ra.hh"
@@ -76,5 +79,120 @@ int main()
         ra::Big<real> z = ra::Big<real, 1>();
         test(z);
     }
+    tr.section("resize and append on any axis");
+    {
+        auto test = [&tr](auto && a)
+            {
+                a = ra::_0*100 + ra::_1*10 + ra::_2;
+                a.resize_axis(2, 6, -1);
+                tr.test_eq(ra::Small<int, 3> {2, 3, 6}, ra::shape(a));
+// room for 8 along axis 2, twice the old size.
+                tr.test_eq(ra::Small<int, 3> {24, 8, 1}, ra::map([&a](int k) { return a.stride(k); }, ra::iota(3)));
+                tr.test_eq(ra::_0*100 + ra::_1*10 + ra::_2, a(ra::all, ra::all, ra::iota(4)));
+                tr.test_eq(-1, a(ra::all, ra::all, ra::iota(2, 4)));
+                a.resize_axis(1, 2);
+                tr.test_eq(ra::Small<int, 3> {2, 2, 6}, ra::shape(a));
+                tr.test_eq(ra::_0*100 + ra::_1*10 + ra::_2, a(ra::all, ra::all, ra::iota(4)));
+                tr.test_eq(-1, a(ra::all, ra::all, ra::iota(2, 4)));
+                a.resize_axis(2, 3);
+                tr.test_eq(ra::_0*100 + ra::_1*10 + ra::_2, a);
+                a.append(0, ra::Small<int, 2, 3> {{7, 8, 9}, {4, 5, 6}});
+                tr.test_eq(ra::Small<int, 3> {3, 2, 3}, ra::shape(a));
+                tr.test_eq(ra::Small<int, 2, 3> {{7, 8, 9}, {4, 5, 6}}, a(2));
+                a.append(1, ra::_0*10 + ra::_1);
+                tr.test_eq(ra::Small<int, 3> {3, 3, 3}, ra::shape(a));
+                tr.test_eq(ra::_0*10 + ra::_1, a(ra::all, 2));
+                tr.test_eq(ra::Small<int, 2, 3> {{7, 8, 9}, {4, 5, 6}}, a(2, ra::iota(2)));
+                a.append(2, 3);
+                tr.test_eq(3, a(ra::all, ra::all, 3));
+                tr.test_eq(ra::_0*10 + ra::_1, a(ra::all, 2, ra::iota(3)));
+            };
+        test(ra::Big<int, 3>({2, 3, 4}, ra::none));
+        test(ra::Big<int>({2, 3, 4}, ra::none));
+// padded rows are padded again.
+        ra::Padded<int, 2> d({2, 3}, ra::_0*10 + ra::_1);
+        d.resize_axis(1, 20, 0);
+        tr.test_eq(32, d.stride(0));
+        tr.test_eq(ra::_0*10 + ra::_1, d(ra::all, ra::iota(3)));
+        tr.test_eq(0, d(ra::all, ra::iota(17, 3)));
+        d.resize_axis(1, 2);
+        tr.test_eq(32, d.stride(0));
+        tr.test_eq(ra::_0*10 + ra::_1, d);
+// growth is geometric.
+        ra::Big<double, 2> b({0, 2}, ra::none);
+        std::vector<double const *> p;
+        for (int i=0; i<1000; ++i) {
+            b.append(0, ra::start({double(i), -double(i)}));
+            p.push_back(b.data());
+        }
+        tr.test_eq(1000, b.size(0));
+        tr.test_eq(ra::_0*(1-2*ra::_1), b);
+        tr.test_le(int(std::set(p.begin(), p.end()).size()), 12);
+        ra::Big<double, 2> c({3, 0}, ra::none);
+        p.clear();
+        for (int i=0; i<1000; ++i) {
+            c.append(1, ra::iota(3, i));
+            p.push_back(c.data());
+        }
+        tr.test_eq(ra::_0 + ra::_1, c);
+        tr.test_le(int(std::set(p.begin(), p.end()).size()), 12);
+// the rows are moved only when the room in stride(0) runs out.
+        std::set<ra::dim_t> strides;
+        ra::Big<double, 2> g({3, 0}, ra::none);
+        for (int i=0; i<1000; ++i) {
+            g.append(1, ra::iota(3, i));
+            strides.insert(g.stride(0));
+        }
+        tr.test_eq(ra::_0 + ra::_1, g);
+        tr.test_le(int(strides.size()), 11);
+        tr.test_le(1000, g.stride(0));
+// begin() makes the array compact.
+        tr.test(!ra::is_c_order(g));
+        double const * gp = g.data();
+        tr.test_eq(ra::_0 + ra::_1, ra::Big<double, 2>({3, 1000}, g.begin()));
+        tr.test(ra::is_c_order(g));
+        tr.test_eq(1000, g.stride(0));
+        tr.test_eq(3000, int(g.store.size()));
+        tr.test(gp==g.data());
+        tr.test_eq(ra::_0 + ra::_1, g);
+        std::sort(g.begin(), g.end(), std::greater<double>());
+        tr.test(std::is_sorted(g.data(), g.data()+g.size(), std::greater<double>()));
+// resize along axis 0 keeps the room along axis 1.
+        ra::Big<int, 2> h({2, 3}, ra::_0*10 + ra::_1);
+        h.resize_axis(1, 4, 9);
+        tr.test_eq(6, h.stride(0));
+        h.resize(3, -1);
+        tr.test_eq(ra::Small<int, 2> {3, 4}, ra::shape(h));
+        tr.test_eq(ra::Small<int, 3, 4> {{0, 1, 2, 9}, {10, 11, 12, 9}, {-1, -1, -1, -1}}, h);
+        h.resize_axis(0, 1);
+        h.append(1, 3);
+        tr.test_eq(ra::Small<int, 1, 5> {{0, 1, 2, 9, 3}}, h);
+// non-trivial elements.
+        ra::Big<std::string, 2> t({2, 1}, ra::none);
+        t(ra::all, 0) = ra::Small<std::string, 2> {"a", "b"};
+        for (int i=0; i<5; ++i) {
+            t.append(1, std::string(1, char('0'+i)));
+        }
+        tr.test(!ra::is_c_order(t));
+        tr.test_eq(std::string("a01234b01234"), std::accumulate(t.begin(), t.end(), std::string()));
+        tr.test(ra::is_c_order(t));
+// reserve makes room along axis 0.
+        ra::Big<double, 2> e({0, 3}, ra::none);
+        e.reserve(100);
+        double const * q = e.data();
+        for (int i=0; i<100; ++i) {
+            e.append(0, ra::iota(3, i));
+        }
+        tr.test(q==e.data());
+        tr.test_eq(ra::_0 + ra::_1, e);
+        ra::Big<int> f({0}, ra::none);
+        f.reserve(10);
+        int const * r = f.data();
+        for (int i=0; i<10; ++i) {
+            f.push_back(i);
+        }
+        tr.test(r==f.data());
+        tr.test_eq(ra::iota(10), f);
+    }
     return tr.summary();
 }
@@ -10,6 +10,7 @@
 
 #include <iostream>
 #include <iterator>
+#include <optional>
 #include "ra/complex.hh"
 #include "ra/test.hh"
 #include "ra/ra.hh"
@@ -48,6 +49,8 @@ using real = double;
 | Small      | copy into | copy into | copy into | copy into   | *copy*    |                  |
 */
 
+template <class A> constexpr bool has_rvalue_iter = requires { std::declval<A>().iter(); };
+
 // TODO Maybe I want Container/View<T> const and Container/View<T const> to behave differently....
 int main()
 {
@@ -150,6 +153,55 @@ int main()
         }
         tr.test_eq(o, 99.);
     }
+    tr.section("Cow");
+    {
+        ra::Cow<int, 2> a({2, 3}, ra::_0 - ra::_1);
+        ra::Cow<int, 2> b = a;
+        tr.test_eq(2, a.use_count());
+        tr.test(std::as_const(a).data()==std::as_const(b).data());
+// reading doesn't detach, even in an expression.
+        tr.test_eq(sum(ra::_0 - ra::_1 + 0*ra::Big<int, 2>({2, 3}, 0)), sum(b));
+        tr.test_eq(2, a.use_count());
+// writing detaches the writer only, whatever the kind of write.
+        b(1, 2) = 99;
+        tr.test_eq(1, a.use_count());
+        tr.test_eq(ra::_0 - ra::_1, a);
+        tr.test_eq(99, b(1, 2));
+        ra::Cow<int, 2> c = a;
+        c += 1;
+        ra::Cow<int, 2> d = a;
+        std::fill(d.begin(), d.end(), 7);
+        tr.test_eq(ra::_0 - ra::_1, a);
+        tr.test_eq(ra::_0 - ra::_1 + 1, c);
+        tr.test_eq(7, d);
+// the sole holder writes in place.
+        int const * p = std::as_const(c).data();
+        c = 3;
+        tr.test(p==std::as_const(c).data());
+    }
+    tr.section("Cow lifetime");
+    {
+// the storage lives as long as any of the copies.
+        ra::Cow<double> b;
+        std::optional<ra::View<double const>> w;
+        {
+            ra::Cow<double> a(ra::Big<double>({3, 2}, ra::_0 + ra::_1));
+            b = a;
+            w.emplace(std::as_const(a).view().dim, std::as_const(a).data());
+        }
+        auto & v = *w;
+        tr.test_eq(1, b.use_count());
+        tr.test(v.data()==std::as_const(b).data());
+        tr.test_eq(ra::_0 + ra::_1, v);
+// a view of a const Cow isn't changed by writes to the copies.
+        ra::Cow<double> c = b;
+        c(ra::all, 0) = 0.;
+        tr.test_eq(ra::_0 + ra::_1, v);
+        tr.test_eq(ra::_1*(ra::_0 + ra::_1), c);
+// temporaries can't be iterated, since the iterator would outlive them.
+        static_assert(!has_rvalue_iter<ra::Cow<double>>);
+        static_assert(has_rvalue_iter<ra::Cow<double> const &>);
+    }
 
     return tr.summary();
 }
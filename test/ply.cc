@@ -11,6 +11,7 @@
 #include <iostream>
 #include <iterator>
 #include <numeric>
+#include <set>
 #include "ra/complex.hh"
 #include "ra/test.hh"
 #include "ra/ra.hh"
@@ -343,5 +344,317 @@ int main()
         tr.test_eq(-99, ra::map([](auto && x) { return -x; }, ra::scalar(99)));
         tr.test_eq(true, every(ra::expr([](auto && x) { return x>0; }, ra::start(99))));
     }
+    tr.section("parallel traversal");
+    {
+        ra::Big<int, 3> a({7, 5, 3}, ra::_0 - ra::_1 + 10*ra::_2);
+        for (int n: {1, 2, 3, 7, 8}) {
+            ra::Big<int, 3> b({7, 5, 3}, 0);
+            ra::ply(ra::par(n), ra::expr([](int & b, int a) { b = 2*a; }, b.iter(), a.iter()));
+            tr.info("ply par ", n).test_eq(2*a, b);
+            ra::Big<int, 3> c({7, 5, 3}, 0);
+            for_each(ra::par(n), [](int & c, int a, int i, int k) { c = a + i*k; }, c, a, ra::_0, ra::_2);
+            tr.info("for_each par ", n).test_eq(a + ra::_0*ra::_2, c);
+        }
+        {
+            ra::Big<int, 2> b({9, 4}, 0);
+            for_each(ra::seq, [](int & b, int i, int j) { b = i-j; }, b, ra::_0, ra::_1);
+            ra::Big<int, 2> c({9, 4}, 0);
+            for_each(ra::par(4), [](int & c, int i, int j) { c = i-j; }, c, ra::_0, ra::_1);
+            tr.info("seq vs par").test_eq(b, c);
+        }
+        {
+            ra::Big<int, 2> b({6, 4}, 0);
+            ra::Big<int, 1> c({6}, 0);
+            for_each(ra::par(3), [](int & b, int c) { b = c; }, transpose<1, 0>(b), ra::iota(4));
+            tr.info("transposed").test_eq(ra::_1+0*ra::_0, b);
+            for_each(ra::par(3), [](int & c, auto && r) { c = sum(r); }, c, iter<1>(b));
+            tr.info("cells").test_eq(6, c);
+        }
+// the outermost axis by stride is axis 1, where c has stride 0, so that one can't be split.
+// the yield is there to let the other threads in if they write to the same element.
+        {
+            ra::Big<int, 2> a({200, 200}, 1);
+            ra::Big<int, 1> c({200}, 0);
+            ra::ThreadPool pool(4);
+            for_each(ra::par(pool, 4), [](auto & c, auto a) { int t = c; std::this_thread::yield(); c = t+a; },
+                     c, transpose<1, 0>(a));
+            tr.info("first leaf has stride 0").test_eq(200, c);
+        }
+// c is broadcast on axis 0, which is also the outermost axis by stride.
+        {
+            ra::Big<int, 2> a({200, 20}, 1);
+            ra::Big<int, 1> c({20}, 0);
+            ra::View<int, 2> cb({ra::Dim {200, 0}, ra::Dim {20, 1}}, c.data());
+            ra::ThreadPool pool(4);
+            for_each(ra::par(pool, 4), [](auto & c, auto a) { int t = c; std::this_thread::yield(); c = t+a; }, cb, a);
+            tr.info("first leaf broadcast on axis 0").test_eq(200, c);
+            ra::Big<int, 2> d({200, 20}, 0);
+            ra::Big<int, 1> e({200}, 1);
+            for_each(ra::par(pool, 4), [](auto & d, auto e) { d = e; }, d, e);
+            tr.info("other leaf broadcast on axis 1").test_eq(1, d);
+        }
+        {
+            ra::Big<int, 2> b({0, 4}, 0);
+            int k = 0;
+            for_each(ra::par(4), [&k](int b) { ++k; }, b);
+            tr.info("empty").test_eq(0, k);
+            ra::Big<int, 0> z({}, 3);
+            for_each(ra::par(4), [&k](int z) { k += z; }, z);
+            tr.info("rank 0").test_eq(3, k);
+        }
+        {
+            ra::Big<int> b({8, 3}, 1); // var rank
+            for_each(ra::par(3), [](int & b, int i) { b += i; }, b, ra::_0);
+            tr.info("var rank").test_eq(1+ra::_0+0*ra::_1, b);
+        }
+        {
+            ra::Big<int, 1> b({100}, ra::_0);
+            int caught = 0;
+            try {
+                for_each(ra::par(4), [](int b) { if (b==77) throw std::runtime_error("77"); }, b);
+            } catch (std::runtime_error & e) {
+                caught = 1;
+            }
+            tr.info("exception from worker").test_eq(1, caught);
+        }
+// leaves whose adv() only takes the steps of plain traversal are moved to the chunks with jump().
+        {
+            std::vector<int> v(100);
+            std::iota(v.begin(), v.end(), 0);
+            int const w[] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 12 };
+            ra::Big<int, 1> b({100}, 0);
+            for_each(ra::par(7), [](int & b, int v, int i) { b = v-i; }, b, ra::start(v), ra::_0);
+            tr.info("Vector and TensorIndex").test_eq(0, b);
+            ra::Big<int, 2> c({10, 3}, 0);
+            for_each(ra::par(4), [](int & c, int w) { c = w; }, c, ra::ptr(w));
+            tr.info("Ptr").test_eq(ra::_0+3+0*ra::_1, c);
+            for_each(ra::par(4), [](int & c, int w) { c = -w; }, c, ra::ptr(w, 10));
+            tr.info("Span").test_eq(-(ra::_0+3)+0*ra::_1, c);
+            tr.info("early exit").test(any(ra::par(4), ra::start(v)==77));
+            tr.info("early exit").test(!any(ra::par(4), ra::start(v)==100));
+        }
+    }
+    tr.section("thread pool");
+    {
+        ra::ThreadPool pool(3, {0});
+        tr.test_eq(3, pool.size());
+        tr.test_eq(3, ra::par(pool).threads());
+        tr.test_eq(5, ra::par(pool, 5).threads());
+        ra::Big<int, 2> a({100, 10}, ra::_0 - ra::_1);
+        ra::Big<int, 1> s({100}, 0);
+// nested parallel calls run on the workers of the outer pool.
+        std::mutex m;
+        std::set<std::thread::id> ids;
+        for_each(ra::par(pool, 8), [&](int & s, auto && r)
+                 {
+                     for_each(ra::par, [&](int r)
+                              {
+                                  std::lock_guard<std::mutex> lock(m);
+                                  s += r;
+                                  ids.insert(std::this_thread::get_id());
+                              }, r);
+                 }, s, iter<1>(a));
+        tr.test_eq(10*ra::iota(100)-45, s);
+        tr.test_le(int(ids.size()), 3);
+        tr.test_eq(sum(a), sum(ra::par(pool), a));
+        int caught = 0;
+        try {
+            for_each(ra::par(pool), [](int a) { for_each(ra::par, [](int b) { if (b==77) throw std::runtime_error("77"); }, ra::iota(100)); }, ra::iota(10));
+        } catch (std::runtime_error & e) {
+            caught = 1;
+        }
+        tr.info("exception from nested").test_eq(1, caught);
+        ra::ThreadPool one(1);
+        tr.test_eq(sum(a), sum(ra::par(one, 4), a));
+// pinned chunks always go to the same threads, so first_touch() and ply_par agree.
+        {
+            auto threads = [&pool](int m)
+            {
+                std::vector<std::thread::id> id(m);
+                pool.run(m, [&](int t) { id[t] = std::this_thread::get_id(); }, true);
+                return id;
+            };
+            for (int m: {3, 7}) {
+                auto id0 = threads(m);
+                for (int k=0; k<20; ++k) {
+                    tr.info("pinned run ", m).test(id0==threads(m));
+                }
+                for (int t=0; t<m; t+=pool.size()) {
+                    tr.info("pinned run ", m, " chunk ", t).test(std::this_thread::get_id()==id0[t]);
+                }
+                tr.info("pinned run ", m).test_eq(3, int(std::set<std::thread::id>(id0.begin(), id0.end()).size()));
+            }
+            auto rows = [&pool](auto && a)
+            {
+                std::vector<std::thread::id> id(a.size(0));
+                ra::Big<int, 1> i({a.size(0)}, ra::_0);
+                for_each(ra::par(pool), [&id](int i, int) { id[i] = std::this_thread::get_id(); }, i, a);
+                return id;
+            };
+            ra::Big<int, 2> b({40, 4}, 0);
+            auto id0 = rows(b);
+            for (int k=0; k<20; ++k) {
+                tr.info("pinned ply_par").test(id0==rows(b));
+            }
+        }
+// async tasks run on the workers, or on the thread that waits for them.
+        for (ra::ThreadPool * p: { &pool, &one }) {
+            int x = 0;
+            auto t = p->async([&x, &a, p] { x = sum(ra::par(*p), a); });
+            tr.test(t.valid());
+            t.wait();
+            tr.test(!t.valid());
+            tr.test_eq(sum(a), x);
+            caught = 0;
+            t = p->async([] { throw std::runtime_error("async"); });
+            try {
+                t.wait();
+            } catch (std::runtime_error & e) {
+                caught = 1;
+            }
+            tr.info("exception from async").test_eq(1, caught);
+        }
+    }
+    tr.section("traversal order");
+    {
+        ra::Big<int, 2> a({3, 4}, ra::_0*4 + ra::_1);
+        auto order = [](auto policy, auto && a)
+                     {
+                         ra::Big<int, 1> v({a.size()}, 0);
+                         int k = 0;
+                         for_each(policy, [&v, &k](int a) { v[k++] = a; }, a);
+                         return v;
+                     };
+        tr.info("row-major").test_eq(ra::iota(12), order(ra::seq, a));
+        tr.info("transposed, memory order").test_eq(ra::iota(12), order(ra::seq, transpose<1, 0>(a)));
+        tr.info("transposed, ordered").test_eq(ra::Big<int, 1> {0, 4, 8, 1, 5, 9, 2, 6, 10, 3, 7, 11},
+                                               order(ra::ordered, transpose<1, 0>(a)));
+        ra::rank_t o[3];
+        ra::Big<int, 3> b({2, 3, 4}, 0);
+        ra::ply_order(transpose<2, 0, 1>(b).iter(), o);
+        tr.info("ply_order innermost first").test_eq(ra::start({1, 0, 2}), ra::ptr(o, 3));
+        ra::Big<int, 3> c({2, 3, 3}, 0);
+        ra::ply_order(ra::expr([](int a, int b) { return a+b; }, c.iter(), transpose<0, 2, 1>(c).iter()), o);
+        tr.info("ply_order ties are row-major").test_eq(ra::start({2, 1, 0}), ra::ptr(o, 3));
+        ra::ply_order(b(ra::all, ra::iota(1), ra::all).iter(), o);
+        tr.info("ply_order size 1 outside").test_eq(ra::start({2, 0, 1}), ra::ptr(o, 3));
+    }
+    {
+        ra::Big<int, 2> a({3, 4}, ra::_0 - ra::_1);
+        auto b = transpose<1, 0>(a);
+        a(1, 2) = -9;
+        a(2, 1) = -9;
+        tr.info("refmin first hit in row-major").test(&a(2, 1)==&refmin(b));
+        a(0, 3) = 9;
+        a(1, 0) = 9;
+        tr.info("refmax first hit in row-major").test(&a(1, 0)==&refmax(b));
+    }
+    tr.section("unit stride inner loop");
+    {
+        using U2 = std::tuple<mp::int_t<1>, mp::int_t<0>>;
+        tr.test(ra::is_unit_stride<U2>(std::make_tuple(ra::dim_t(1), ra::dim_t(0))));
+        tr.test(!ra::is_unit_stride<U2>(std::make_tuple(ra::dim_t(1), ra::dim_t(1))));
+        tr.test(!ra::is_unit_stride<U2>(std::make_tuple(ra::dim_t(2), ra::dim_t(0))));
+        tr.test(!ra::is_unit_stride<U2>(ra::dim_t(1)));
+        ra::Big<int, 2> a({4, 5}, ra::_0 - ra::_1);
+        ra::Big<int, 2> b({4, 5}, 0);
+        b = a*2 + ra::_1 + ra::iota(4);
+        tr.info("unit stride").test_eq(ra::Big<int, 2>({4, 5}, 3*ra::_0 - ra::_1), b);
+        b = ra::where(a>0, a, -a) + a(ra::all, 0);
+        tr.info("unit stride pick, stride 0").test_eq(abs(a) + ra::_0, b);
+        ra::Big<int, 2> c({4, 5}, ra::_0*5 + ra::_1);
+        b = c(ra::all, ra::iota(5, 4, -1)) + c;
+        tr.info("non unit stride").test_eq(ra::_0*10 + 4, b);
+    }
+    tr.section("end-of-dim pointer stack");
+    {
+        static_assert(std::is_same_v<int *, ra::flat_first<int *>::type>);
+        static_assert(std::is_same_v<int *, ra::flat_first<decltype(ra::Big<int, 2>().iter().flat())>::type>);
+        static_assert(std::is_same_v<int *, ra::flat_first<decltype((-ra::Big<int, 2>()+1).flat())>::type>);
+        static_assert(!std::is_pointer_v<ra::flat_first<decltype((1+ra::Big<int, 2>()).flat())>::type>);
+        ra::Big<int, 4> a({2, 3, 4, 5}, ra::_0*1000 + ra::_1*100 + ra::_2*10 + ra::_3);
+        ra::Big<int, 4> b({2, 3, 4, 5}, 0);
+        b = a(ra::all, ra::all, ra::iota(4, 3, -1), ra::all);
+        tr.info("rank 4, negative stride").test_eq(ra::_0*1000 + ra::_1*100 + (3-ra::_2)*10 + ra::_3, b);
+        ra::Big<int, 4> c({5, 4, 3, 2}, 0);
+        c = transpose<3, 2, 1, 0>(a);
+        tr.info("rank 4, transposed").test_eq(ra::_3*1000 + ra::_2*100 + ra::_1*10 + ra::_0, c);
+        ra::Big<int, 2> d({2, 3}, ra::_0*3 + ra::_1);
+        ra::Big<int, 3> e({2, 3, 4}, 0);
+        e = d;
+        tr.info("frame match").test_eq(ra::_0*3 + ra::_1 + 0*ra::_2, e);
+        e = 2*d + (e-1)*3;
+        tr.info("nested").test_eq((ra::_0*3 + ra::_1)*5 - 3 + 0*ra::_2, e);
+        ra::Big<int, 3> f({2, 3, 4}, 1);
+        ra::Big<int, 2> g({2, 3}, 0);
+        g += f;
+        tr.info("lower rank first leaf").test_eq(4, g);
+        ra::Big<int, 3> h({2, 1, 4}, ra::_0*10 + ra::_2);
+        ra::Big<int, 3> i({2, 1, 2}, 0);
+        i = h(ra::all, ra::all, ra::iota(2, 0, 2)) + h(ra::all, ra::all, ra::iota(2, 1, 2));
+        tr.info("size 1, non compact").test_eq(2*ra::_0*10 + 4*ra::_2 + 1, i);
+        ra::Big<int, 4> j({2, 3, 4, 5}, 0);
+        j(ra::iota(2, 1, -1), ra::all, ra::iota(4, 3, -1)) = a;
+        tr.info("negative strides on the first leaf").test_eq((1-ra::_0)*1000 + ra::_1*100 + (3-ra::_2)*10 + ra::_3, j);
+        ra::Big<int, 1> k({5}, 0);
+        ra::View<int, 3> kb({ra::Dim {3, 0}, ra::Dim {4, 0}, ra::Dim {5, 1}}, k.data());
+        kb += a(1);
+        tr.info("stride 0 on the first leaf").test_eq(1000*12 + 4*300 + 3*60 + 12*ra::_0, k);
+    }
+    tr.section("static traversal of small arrays");
+    {
+        using S3 = ra::Small<int, 3, 3, 3>;
+        static_assert(ra::StaticKeepStride<decltype(ra::start(S3()))>);
+        static_assert(ra::StaticKeepStride<decltype(ra::start(S3())+1)>);
+        static_assert(ra::StaticKeepStride<decltype(ra::start(S3())+ra::_0)>);
+        static_assert(!ra::StaticKeepStride<decltype(ra::start(ra::Big<int, 3>()))>);
+        static_assert(!ra::StaticKeepStride<decltype(ra::start(S3())+ra::start(ra::Big<int, 3>()))>);
+        static_assert(std::get<1>(ra::ocd<decltype(ra::start(S3()))>())==3);
+        static_assert(std::get<0>(ra::ocd<decltype(ra::start(S3()))>())==27);
+        static_assert(std::get<1>(ra::ocd<decltype(ra::start(transpose<1, 0, 2>(S3())))>())==1);
+        S3 a = ra::_0*9 + ra::_1*3 + ra::_2;
+        S3 b = 0;
+        ra::plyf(ra::map([](int & b, int a) { b = 2*a; }, b, a));
+        tr.test_eq(2*(ra::_0*9 + ra::_1*3 + ra::_2), b);
+        ra::plyf(ra::map([](int & b, int a) { b = a; }, b, transpose<1, 0, 2>(a)));
+        tr.test_eq(ra::_1*9 + ra::_0*3 + ra::_2, b);
+        ra::Small<int, 3> c = { 1, 2, 3 };
+        b = a + c;
+        tr.test_eq(ra::_0*9 + ra::_1*3 + ra::_2 + ra::_0 + 1, b);
+        b = 0;
+        b(ra::all, 1) = c;
+        tr.test_eq((ra::_1==1)*(ra::_0 + 1), b);
+        ra::Small<int, 9, 9> d = ra::_0 - ra::_1;
+        ra::Small<int, 9, 9> e = 0;
+        e += d*2;
+        tr.test_eq(2*(ra::_0 - ra::_1), e);
+        e = transpose<1, 0>(d);
+        tr.test_eq(ra::_1 - ra::_0, e);
+    }
+    tr.section("tiled traversal");
+    {
+        for (int n: {1, 4, 16, 100, 4096}) {
+            ra::Big<int, 2> a({13, 7}, 10*ra::_0 + ra::_1);
+            ra::Big<int, 2> b({7, 13}, 0);
+            ra::ply(ra::tiled(n), ra::expr([](int & b, int a) { b += a+1; }, b.iter(), transpose<1, 0>(a).iter()));
+            tr.info("transpose ", n).test_eq(transpose<1, 0>(a)+1, b);
+            ra::Big<int, 3> c({5, 6, 7}, 0);
+            ra::Big<int, 3> d({6, 7, 5}, 10*ra::_0 + ra::_1 - 100*ra::_2);
+            for_each(ra::tiled(n), [](int & c, int d, int i) { c += d+i; }, c, transpose<1, 2, 0>(d), ra::_0);
+            tr.info("rank 3 ", n).test_eq(transpose<1, 2, 0>(d) + ra::_0, c);
+        }
+        {
+            ra::Big<int, 2> a({0, 7}, 0);
+            int k = 0;
+            for_each(ra::tiled(4), [&k](int a, int b) { ++k; }, a, transpose<1, 0>(ra::Big<int, 2>({7, 0}, 0)));
+            tr.info("empty").test_eq(0, k);
+        }
+        {
+            ra::Big<int> a({9, 8}, 0); // var rank
+            ra::Big<int, 2> b({8, 9}, ra::_0 - ra::_1);
+            for_each(ra::tiled(9), [](int & a, int b) { a = b; }, a, transpose<1, 0>(b));
+            tr.info("var rank").test_eq(transpose<1, 0>(b), a);
+        }
+    }
     return tr.summary();
 }
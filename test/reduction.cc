@@ -309,5 +309,63 @@ int main()
         tr.test_eq(B, A);
         // cout << refmin(A+B) << endl; // compile error
     }
+    tr.section("reductions with several accumulators, parallel");
+    {
+        tr.test_eq(10, reduce(ra::reduction(0, [](int c, int a) { return c+a; }), ra::iota(5)));
+        tr.test_eq(0, reduce(ra::reduction(0, [](int c, int a) { return c+a; }), ra::iota(0)));
+        tr.test_eq(-99, reduce(ra::reduction(-99, [](int c, int a) { return std::max(c, a); }), ra::iota(0)));
+        for (int n: {0, 1, 3, 4, 5, 17, 1000}) {
+            ra::Big<int, 1> a = ra::iota(n, 1);
+            ra::Big<int, 2> b({n, 3}, ra::_0 - ra::_1);
+            tr.info("sum ", n).test_eq(n*(n+1)/2, sum(a));
+            tr.info("sum par ", n).test_eq(n*(n+1)/2, sum(ra::par(3), a));
+            tr.info("sum 2 ", n).test_eq(3*(n*(n-1)/2) - 3*n, sum(b));
+            tr.info("sum 2 par ", n).test_eq(3*(n*(n-1)/2) - 3*n, sum(ra::par(4), b));
+            tr.info("sum 2 transposed par ", n).test_eq(3*(n*(n-1)/2) - 3*n, sum(ra::par(4), transpose<1, 0>(b)));
+            tr.info("prod ", n).test_eq(ra::prod(ra::Big<int, 1>({n}, 1)*-1), ra::prod(ra::par(2), ra::Big<int, 1>({n}, -1)));
+            tr.info("amax ", n).test_eq(n==0 ? std::numeric_limits<int>::lowest() : n-1, amax(b));
+            tr.info("amax par ", n).test_eq(n==0 ? std::numeric_limits<int>::lowest() : n-1, amax(ra::par(4), b));
+            tr.info("amin par ", n).test_eq(n==0 ? std::numeric_limits<int>::max() : -2, amin(ra::par(4), b));
+            tr.info("dot ", n).test_eq(n*(n+1)*(2*n+1)/6, dot(a, a));
+            tr.info("dot par ", n).test_eq(n*(n+1)*(2*n+1)/6, dot(ra::par(5), a, a));
+            tr.info("reduce_sqrm par ", n).test_eq(n*(n+1)*(2*n+1)/6, reduce_sqrm(ra::par(5), a));
+        }
+        ra::Big<double, 1> x({4}, ra::_0 + 1.);
+        tr.test_eq(std::sqrt(30.), norm2(ra::par(2), x));
+        tr.test_eq(std::sqrt(30.), norm2(ra::seq, x));
+        ra::Big<std::complex<double>, 1> z = { 0., std::complex<double>(0, 1), std::complex<double>(0, 2) };
+        tr.test_eq(5., cdot(ra::par(2), z, z));
+        tr.test_eq(5., cdot(z, z));
+        tr.test_eq(-5., dot(z, z));
+        tr.test_eq(amax(x), amax(ra::par(2), x));
+        ra::Big<double, 1> nan = { 1., std::numeric_limits<double>::quiet_NaN(), 3., 2., 0.5 };
+        tr.test_eq(3., amax(nan));
+        tr.test_eq(0.5, amin(nan));
+        ra::Small<double, 3> s = { 1, 2, 3 };
+        tr.test_eq(14, dot(s, s));
+        tr.test_eq(6, sum(ra::par, s));
+    }
+    tr.section("pairwise and compensated sums");
+    {
+        int const n = 1000000;
+        ra::Big<float, 1> a({n}, 0.1f);
+        double ref = n*double(0.1f);
+        double e = std::abs(sum(a)-ref);
+        tr.info("sum error ", e).test_lt(100*std::abs(sum_pairwise(a)-ref), e);
+        tr.info("sum error ", e).test_lt(100*std::abs(sum_kahan(a)-ref), e);
+        tr.info("pairwise").test_rel_error(ref, double(sum_pairwise(a)), 1e-6);
+        tr.info("kahan").test_rel_error(ref, double(sum_kahan(a)), 1e-7);
+        tr.info("pairwise par").test_rel_error(ref, double(sum_pairwise(ra::par(3), a)), 1e-6);
+        tr.info("kahan par").test_rel_error(ref, double(sum_kahan(ra::par(3), a)), 1e-7);
+        ra::Big<float, 2> b({n/1000, 1000}, 0.1f);
+        tr.info("pairwise transposed").test_rel_error(ref, double(sum_pairwise(transpose<1, 0>(b))), 1e-6);
+        tr.info("kahan transposed").test_rel_error(ref, double(sum_kahan(transpose<1, 0>(b))), 1e-7);
+        tr.info("kahan ordered").test_rel_error(ref, double(sum_kahan(ra::ordered, transpose<1, 0>(b))), 1e-7);
+        tr.info("dot pairwise").test_rel_error(n*double(0.1f)*2, double(dot_pairwise(a, ra::Big<float, 1>({n}, 2.f))), 1e-6);
+        tr.info("dot kahan par").test_rel_error(n*double(0.1f)*2, double(dot_kahan(ra::par, a, ra::Big<float, 1>({n}, 2.f))), 1e-7);
+        tr.test_eq(0, sum_pairwise(ra::Big<int, 1>({0}, 0)));
+        tr.test_eq(6, sum_kahan(ra::Small<int, 3> {1, 2, 3}));
+        tr.test_eq(6, sum_pairwise(ra::Small<int, 3> {1, 2, 3}));
+    }
     return tr.summary();
 }
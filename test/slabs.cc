@@ -0,0 +1,157 @@
+// -*- mode: c++; coding: utf-8 -*-
+/// @file slabs.cc
+/// @brief Tests for reading and writing binary arrays a slab at a time.
+
+// This library is free software; you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option) any
+// later version.
+
+#include <sstream>
+#include "ra/test.hh"
+#include "ra/ra.hh"
+#include "ra/slabs.hh"
+
+using std::cout, std::endl, ra::TestRecorder;
+
+int main()
+{
+    TestRecorder tr(std::cout);
+    tr.section("read in slabs");
+    {
+        ra::Big<double, 3> a({10, 4, 2}, ra::_0*0.5 - ra::_1 + ra::_2*3);
+        for (ra::dim_t rows: {1, 3, 10, 20}) {
+            std::stringstream s;
+            write_binary(s, a);
+            ra::SlabReader<double, 3> r(s, rows);
+            tr.test_eq(ra::start({10, 4, 2}), ra::start(r.shape()));
+            ra::Big<double, 3> b({10, 4, 2}, 0.);
+            int n = 0;
+            while (r.next()) {
+                auto v = r.slab();
+                tr.test_eq(std::min(rows, 10-r.position()), v.size(0));
+                b(ra::iota(v.size(0), r.position())) = v;
+                ++n;
+            }
+            tr.info(rows).test_eq((10+rows-1)/rows, n);
+            tr.info(rows).test_eq(a, b);
+            tr.test(!r.next());
+        }
+    }
+    tr.section("kernels run unchanged on each slab");
+    {
+        ra::Big<int, 2> a({7, 5}, ra::_0 - ra::_1*2);
+        std::stringstream s;
+        write_binary(s, a);
+        ra::Big<int, 1> rowsum({7}, 0);
+        ra::SlabReader<int> r(s, 3);
+        while (r.next()) {
+            auto v = r.slab();
+            tr.test_eq(2, v.rank());
+            for_each([](int & c, auto && row) { c = sum(row); }, rowsum(ra::iota(v.size(0), r.position())), iter<1>(v));
+        }
+        tr.test_eq(ra::Big<int, 1>({7}, ra::_0*5 - 20), rowsum);
+        int total = 0;
+        std::stringstream t;
+        write_binary(t, a);
+        ra::for_each_slab<int, 2>(t, 2, [&](auto && v) { total += sum(v); });
+        tr.test_eq(sum(a), total);
+    }
+    tr.section("empty or bad input");
+    {
+        std::stringstream s;
+        write_binary(s, ra::Big<float, 2>({0, 3}, 0.f));
+        ra::SlabReader<float, 2> r(s, 4);
+        tr.test(!r.next());
+        std::stringstream t("not a binary array");
+        ra::SlabReader<float, 2> q(t, 4);
+        tr.test(!q.next());
+        tr.test(t.fail());
+        std::stringstream t1;
+        write_binary(t1, ra::Big<double, 2>({6, 3}, ra::_0));
+        ra::SlabReader<float, 2> q1(t1, 4);
+        tr.info("element type").test(!q1.next());
+        tr.test(t1.fail());
+        std::stringstream t2;
+        write_binary(t2, ra::Big<float, 1>({6}, ra::_0));
+        ra::SlabReader<float, 2> q2(t2, 4);
+        tr.info("rank").test(!q2.next());
+        tr.test(t2.fail());
+// truncated input
+        std::stringstream u;
+        write_binary(u, ra::Big<float, 2>({6, 3}, ra::_0));
+        std::stringstream v(u.str().substr(0, u.str().size()-4));
+        ra::SlabReader<float, 2> w(v, 4);
+        tr.test(w.next());
+        tr.test_eq(4, w.slab().size(0));
+// a short read isn't the end of the input.
+        bool threw = false;
+        try {
+            w.next();
+        } catch (std::runtime_error & e) {
+            cout << e.what() << endl;
+            threw = true;
+        }
+        tr.test(threw);
+        tr.test(v.fail());
+    }
+    tr.section("slabs are read and written on a given pool");
+    {
+        ra::Big<int, 2> a({9, 4}, ra::_0*4 + ra::_1);
+        for (int n: {1, 3}) {
+            ra::ThreadPool pool(n);
+            std::stringstream s;
+            {
+                ra::SlabWriter<int, 2> w(s, {9, 4}, 2, pool);
+                for (ra::dim_t i=0; i<9; i+=2) {
+                    w.write(a(ra::iota(std::min(ra::dim_t(2), 9-i), i)));
+                }
+                w.close();
+            }
+            ra::Big<int, 2> b({9, 4}, 0);
+            for (ra::SlabReader<int, 2> r(s, 4, pool); r.next(); ) {
+// nested parallel work goes to the same pool.
+                b(ra::iota(r.slab().size(0), r.position())) = r.slab();
+                tr.test_eq(sum(r.slab()), sum(ra::par(pool), r.slab()));
+            }
+            tr.info("pool of ", n).test_eq(a, b);
+        }
+    }
+    tr.section("write in slabs");
+    {
+        ra::Big<double, 3> a({11, 3, 2}, ra::_0*0.5 - ra::_1 + ra::_2*3);
+        std::stringstream s;
+        {
+            ra::SlabWriter<double, 3> w(s, {11, 3, 2}, 4);
+            for (ra::dim_t i=0; i<11; i+=4) {
+// views or expressions, of any number of rows up to the slab size.
+                if (i%8==0) {
+                    w.write(a(ra::iota(std::min(ra::dim_t(4), 11-i), i)));
+                } else {
+                    w.write(2*a(ra::iota(std::min(ra::dim_t(4), 11-i), i)));
+                }
+            }
+            w.close();
+        }
+        ra::Big<double, 3> b;
+        read_binary(s, b);
+        tr.test_eq(a(ra::iota(4)), b(ra::iota(4)));
+        tr.test_eq(2*a(ra::iota(4, 4)), b(ra::iota(4, 4)));
+        tr.test_eq(a(ra::iota(3, 8)), b(ra::iota(3, 8)));
+// write and read back slab by slab.
+        std::stringstream t;
+        {
+            ra::SlabWriter<int> w(t, {5, 2}, 2);
+            for (int i=0; i<5; ++i) {
+                w.write(ra::Small<int, 1, 2> {i, -i});
+            }
+            w.close();
+        }
+        ra::Big<int, 2> c({5, 2}, 0);
+        for (ra::SlabReader<int, 2> r(t, 3); r.next(); ) {
+            c(ra::iota(r.slab().size(0), r.position())) = r.slab();
+        }
+        tr.test_eq(ra::Big<int, 2>({5, 2}, {0, 0, 1, -1, 2, -2, 3, -3, 4, -4}), c);
+    }
+    return tr.summary();
+}
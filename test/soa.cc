@@ -0,0 +1,100 @@
+// -*- mode: c++; coding: utf-8 -*-
+/// @file soa.cc
+/// @brief Tests for the structure-of-arrays container.
+
+// This library is free software; you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option) any
+// later version.
+
+#include "ra/ra.hh"
+#include "ra/test.hh"
+
+using std::cout, std::endl, ra::TestRecorder;
+using Vec = ra::Small<double, 3>;
+
+int main()
+{
+    TestRecorder tr;
+    tr.section("default is empty");
+    {
+        ra::SoA<double, 3> a;
+        tr.test_eq(2, a.rank());
+        tr.test_eq(0, a.size());
+        tr.test_eq(ra::Small<int, 2> {0, 3}, ra::shape(a));
+        ra::SoA<double, 3, 2> b;
+        tr.test_eq(0, b.size());
+        ra::SoA<double, 3, 0> c;
+        tr.test_eq(3, c.size());
+    }
+    tr.section("layout");
+    {
+        ra::Big<Vec, 1> aos({4}, ra::map([](int i) { return Vec {double(i), 10.*i, 100.*i}; }, ra::_0));
+        ra::SoA<double, 3, 1> a(aos);
+        tr.test_eq(ra::Small<int, 2> {4, 3}, ra::shape(a));
+        tr.test_eq(ra::Small<int, 2> {1, 4}, ra::map([&a](int k) { return a.stride(k); }, ra::iota(2)));
+        tr.test_eq(1, a.component(1).stride(0));
+        tr.test_eq(ra::_0*10., a.component(1));
+        tr.test_eq(ra::_0*100., a(ra::all, 2));
+        a.component(0) += 1.;
+        tr.test_eq(ra::_0 + 1., a(ra::all, 0));
+// back to AoS.
+        ra::Big<Vec, 1> c({4}, ra::none);
+        c = ra::iter<1>(a);
+        tr.test_eq(ra::map([](int i) { return Vec {i+1., 10.*i, 100.*i}; }, ra::_0), c);
+    }
+    tr.section("elements work like Small");
+    {
+        ra::SoA<double, 3, 2> a({2, 4}, ra::scalar(Vec {1, 2, 3}));
+        static_assert(std::is_same_v<ra::SoAElement<double, 3>, decltype(a(1, 2))>);
+        static_assert(3==ra::size_s<decltype(a(1, 2))>());
+        auto e = a(1, 2);
+        tr.test_eq(2., e[1]);
+        e[1] = 7.;
+        tr.test_eq(7., a.component(1)(1, 2));
+        e = Vec {4, 5, 6};
+        tr.test_eq(Vec {4, 5, 6}, a(1, 2));
+        e += 1.;
+        tr.test_eq(Vec {5, 6, 7}, a(1, 2));
+        a(0, 0) = a(1, 2);
+        tr.test_eq(Vec {5, 6, 7}, a(0, 0));
+        Vec v = a(1, 2);
+        tr.test_eq(Vec {5, 6, 7}, v);
+        tr.test_eq(18., sum(a(1, 2)));
+        tr.test_eq(Vec {10, 12, 14}, a(1, 2)*2.);
+        ra::SoA<double, 3, 2> const & b = a;
+        static_assert(std::is_same_v<ra::SoAElement<double const, 3>, decltype(b(1, 2))>);
+        tr.test_eq(Vec {5, 6, 7}, b(1, 2));
+        ra::SoA<double, 3, 1> c({3}, 0.);
+        c[1] = Vec {1, 2, 3};
+        tr.test_eq(Vec {1, 2, 3}, c[1]);
+// with var rank, use element().
+        ra::SoA<double, 3> d({2, 4}, ra::scalar(Vec {1, 2, 3}));
+        d.element(1, 3) = Vec {4, 5, 6};
+        tr.test_eq(Vec {4, 5, 6}, d.element(1, 3));
+        tr.test_eq(Vec {4, 5, 6}, d(1, 3));
+    }
+    tr.section("rank extension on the component axis");
+    {
+        ra::SoA<double, 3, 1> a({4}, ra::none);
+        a = ra::map([](int i) { return Vec {double(i), 10.*i, 100.*i}; }, ra::_0);
+        ra::Big<double, 1> w({4}, ra::_0);
+        ra::Big<double, 2> b = a*w;
+        tr.test_eq(Vec {3, 30, 300}*3., b(3));
+        tr.test_eq(ra::Small<double, 4> {0, 111, 222, 333}, ra::map([](auto && x) { return ra::sum(x); }, ra::iter<1>(a)));
+        ra::Big<double, 1> n({4}, 0.);
+        for_each(ra::wrank<0, 1>([](double & n, auto && x) { n += ra::sum(x*x); }), n, a);
+        tr.test_eq(ra::_0*ra::_0*10101., n);
+// a scalar goes to every component.
+        ra::SoA<int, 2> d({2, 3}, 5);
+        tr.test_eq(3, d.rank());
+        tr.test_eq(5, d);
+        d(ra::all, ra::all, 1) = ra::_0 + ra::_1;
+        tr.test_eq(ra::_0 + ra::_1, d.component(1));
+        tr.test_eq(6, d.stride(2));
+        ra::SoA<int, 2> e = d;
+        tr.test_eq(d, e);
+        tr.test(d.data()!=e.data());
+    }
+    return tr.summary();
+}
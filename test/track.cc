@@ -0,0 +1,126 @@
+// -*- mode: c++; coding: utf-8 -*-
+/// @file track.cc
+/// @brief Tests for the accounting of Container allocations.
+
+// This library is free software; you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option) any
+// later version.
+
+#define RA_DO_TRACK 1
+
+#include "ra/ra.hh"
+#include "ra/huge.hh"
+#include "ra/test.hh"
+
+using std::cout, std::endl, ra::TestRecorder;
+using z = std::size_t;
+
+int main()
+{
+    TestRecorder tr(std::cout);
+    tr.section("count, bytes, live, peak");
+    {
+        ra::track_reset();
+        auto s0 = ra::track_snapshot().total;
+        {
+            ra::Big<double, 2> a({10, 10}, 1.);
+            auto s1 = ra::track_snapshot().total;
+            tr.test_eq(z(1), s1.count-s0.count);
+            tr.test_eq(z(800), s1.bytes-s0.bytes);
+            tr.test_eq(z(800), s1.live-s0.live);
+            {
+                ra::Big<double, 2> b = a*2.;
+                ra::Aligned<double, 1> c({100}, 3.);
+                auto s2 = ra::track_snapshot().total;
+                tr.test_eq(z(3), s2.count-s0.count);
+                tr.test_eq(z(2400), s2.live-s0.live);
+                tr.test_eq(s2.live, s2.peak);
+            }
+            auto s3 = ra::track_snapshot().total;
+            tr.test_eq(z(800), s3.live-s0.live);
+            tr.test_eq(z(2400), s3.peak-s0.live);
+        }
+        tr.test_eq(s0.live, ra::track_snapshot().total.live);
+    }
+    tr.section("stores that aren't std::vector");
+    {
+        auto s0 = ra::track_snapshot().total;
+        {
+            ra::Shared<int, 1> a({10}, 0);
+            ra::Unique<int, 1> b({10}, 0);
+            auto s1 = ra::track_snapshot().total;
+            tr.test_eq(z(2), s1.count-s0.count);
+            tr.test_eq(z(80), s1.bytes-s0.bytes);
+            tr.test_eq(z(80), s1.live-s0.live);
+        }
+        tr.test_eq(s0.live, ra::track_snapshot().total.live);
+    }
+    tr.section("Unique blocks are followed through moves and reinit");
+    {
+        auto s0 = ra::track_snapshot().total;
+        {
+            ra::Unique<int, 1> a({10}, 0);
+            ra::Unique<int, 1> b(std::move(a));
+            tr.test_eq(z(40), ra::track_snapshot().total.live-s0.live);
+            b = ra::Unique<int, 1>({20}, 1);
+            tr.test_eq(z(80), ra::track_snapshot().total.live-s0.live);
+            b = std::move(b);
+            tr.test_eq(z(80), ra::track_snapshot().total.live-s0.live);
+            ra::Unique<int, 1> c({5}, 2);
+            swap(b, c);
+            tr.test_eq(z(100), ra::track_snapshot().total.live-s0.live);
+        }
+        tr.test_eq(s0.live, ra::track_snapshot().total.live);
+    }
+    tr.section("tags and scopes");
+    {
+        ra::track_reset();
+        ra::Big<double, 1> a({100}, ra::_0);
+        {
+            ra::TrackScope outer("outer");
+            ra::Big<double, 1> b = a+1.;
+            {
+                ra::TrackScope inner("inner");
+                auto c = concrete(a*b);
+                auto d = concrete(c+a);
+                tr.test_eq(z(2), inner.report().count);
+                tr.test_eq(z(1600), inner.report().live);
+            }
+            auto r = outer.report();
+            tr.test_eq(z(3), r.count);
+            tr.test_eq(z(2400), r.bytes);
+            tr.test_eq(z(800), r.live);
+            tr.test_eq(z(800), r.peak);
+        }
+        auto s = ra::track_snapshot();
+        cout << s << endl;
+        tr.test_eq(z(1), s.tags.at("").count);
+        tr.test_eq(z(1), s.tags.at("outer").count);
+        tr.test_eq(z(0), s.tags.at("outer").live);
+        tr.test_eq(z(2), s.tags.at("inner").count);
+        tr.test_eq(z(1600), s.tags.at("inner").peak);
+        tr.test_eq(z(0), s.tags.at("inner").live);
+    }
+    tr.section("reset");
+    {
+        ra::Big<char, 1> a({1000}, 'a');
+        ra::track_reset();
+        auto s = ra::track_snapshot().total;
+        tr.test_eq(z(0), s.count);
+        tr.test_eq(z(0), s.bytes);
+        tr.test_le(1000, int(s.live));
+        tr.test_eq(s.live, s.peak);
+    }
+    tr.section("huge pages");
+    {
+        ra::track_reset();
+        {
+            ra::Huge<double, 1> a({1<<20}, 0.);
+            tr.test_eq(z(8<<20), ra::track_snapshot().total.live);
+        }
+        tr.test_eq(z(0), ra::track_snapshot().total.live);
+        tr.test_eq(z(8<<20), ra::track_snapshot().total.peak);
+    }
+    return tr.summary();
+}
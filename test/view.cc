@@ -202,5 +202,38 @@ int main()
         tr.test(is_ravel_free(c));
         tr.test_eq(ra::iota(10, 0, 2), ravel_free(c));
     }
+    tr.section("var rank dope vector is inline up to dimv_inline");
+    {
+        ra::Big<int> a({2, 3, 4}, ra::_0*100 + ra::_1*10 + ra::_2);
+        auto b = a(1);
+        tr.test_eq(2, b.rank());
+        tr.test(!b.dim.heap);
+        tr.test_eq(ra::_0*10 + ra::_1 + 100, b);
+        auto c = b;
+        c.dim[0].stride = 0;
+        tr.test_eq(4, b.dim[0].stride);
+        auto t = transpose({1, 0}, b);
+        tr.test(!t.dim.heap);
+        tr.test_eq(4, t.size(0));
+        tr.test_eq(3, t.size(1));
+    }
+    tr.section("var rank dope vector goes to the heap beyond dimv_inline");
+    {
+        ra::Big<int> a(ra::Small<int, 10> {1, 2, 1, 1, 1, 1, 1, 1, 1, 3}, ra::none);
+        std::iota(a.begin(), a.end(), 0);
+        tr.test(bool(a.dim.heap));
+        tr.test_eq(10, a.rank());
+        auto b = a(0, 1);
+        tr.test_eq(8, b.rank());
+        tr.test(!b.dim.heap);
+        tr.test_eq(5, b(0, 0, 0, 0, 0, 0, 0, 2));
+        auto c = a;
+        tr.test_eq(ra::start(a), ra::start(c));
+        tr.test(c.dim.data()!=a.dim.data());
+        decltype(c.dim) d = std::move(c.dim);
+        tr.test_eq(0, c.dim.size());
+        tr.test_eq(10, d.size());
+        tr.test_eq(3, d.back().size);
+    }
     return tr.summary();
 }